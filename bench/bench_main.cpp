@@ -0,0 +1,374 @@
+#include "beamformer.h"
+#include "file_io.h"
+#include "config_file.h"
+#include "simd_utils.h"
+#include "pipeline_stats.h"
+#include <string>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+// --compare steers both engines here for the output check, off broadside
+// so the fractional delays are exercised, and counts DOA estimates this
+// close as agreeing
+#define COMPARE_ANGLE 60
+#define COMPARE_DOA_TOLERANCE 5
+
+// Run the engine under test and a reference over the input in lockstep:
+// first both fixed on COMPARE_ANGLE so only the beamforming differs, then
+// both tracking to compare their DOA decisions
+static bool compareEngines(const BeamFormerConfig& config, BeamformerEngine reference,
+                           const std::vector<float>& samples, ErrorHandler* errorHandler, Logger* logger) {
+    BeamFormerConfig referenceConfig = config;
+    referenceConfig.engine = reference;
+    const size_t frameSamples = config.frameSize * config.geometry.deviceChannels;
+    const size_t outSamples = config.frameSize * config.beamCount();
+    std::vector<float> output(outSamples);
+    std::vector<float> expected(outSamples);
+    
+    double signal = 0.0;
+    double noise = 0.0;
+    float maxError = 0.0f;
+    {
+        BeamFormer test(nullptr, nullptr, errorHandler, logger, config);
+        BeamFormer ref(nullptr, nullptr, errorHandler, logger, referenceConfig);
+        if (!test.init() || !ref.init() || !test.requestSteering(COMPARE_ANGLE) || !ref.requestSteering(COMPARE_ANGLE)) {
+            return false;
+        }
+        for (size_t offset = 0; offset + frameSamples <= samples.size(); offset += frameSamples) {
+            if (!test.processFrame(samples.data() + offset, output.data()) ||
+                !ref.processFrame(samples.data() + offset, expected.data())) {
+                return false;
+            }
+            for (size_t i = 0; i < outSamples; i++) {
+                float error = output[i] - expected[i];
+                signal += (double)expected[i] * expected[i];
+                noise += (double)error * error;
+                maxError = std::max(maxError, fabsf(error));
+            }
+        }
+    }
+    
+    int estimates = 0;
+    int agreeing = 0;
+    double totalDifference = 0.0;
+    {
+        BeamFormer test(nullptr, nullptr, errorHandler, logger, config);
+        BeamFormer ref(nullptr, nullptr, errorHandler, logger, referenceConfig);
+        if (!test.init() || !ref.init()) {
+            return false;
+        }
+        for (size_t offset = 0; offset + frameSamples <= samples.size(); offset += frameSamples) {
+            if (!test.processFrame(samples.data() + offset, output.data()) ||
+                !ref.processFrame(samples.data() + offset, expected.data())) {
+                return false;
+            }
+            
+            BeamFormerStatus a, b;
+            if (!test.readStatus(a) || !ref.readStatus(b) || a.doaAngle < 0 || b.doaAngle < 0) {
+                continue;
+            }
+            int difference = std::abs(a.doaAngle - b.doaAngle);
+            if (a.angleCount == 360) {
+                difference = std::min(difference, 360 - difference);  // Azimuth wraps around
+            }
+            estimates++;
+            agreeing += difference <= COMPARE_DOA_TOLERANCE;
+            totalDifference += difference;
+        }
+    }
+    
+    printf("Compared with %s: output max error %.2f LSB (S16), SNR %.1f dB, both steered to %d degrees\n",
+           engineName(reference), maxError * 32768.0f,
+           noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY, COMPARE_ANGLE);
+    printf("DOA over %d frames: %.1f%% within %d degrees, mean difference %.2f degrees\n", estimates,
+           estimates ? 100.0 * agreeing / estimates : 0.0, COMPARE_DOA_TOLERANCE,
+           estimates ? totalDifference / estimates : 0.0);
+    return true;
+}
+
+// Offline benchmark: runs the BeamFormer over an audio file as fast as the
+// pipeline allows and reports throughput and per-frame processing latency
+int main(int argc, char* argv[]) {
+    std::string inputFile;
+    std::string outputFile;  // Empty to discard the output
+    bool loggingEnabled = false;
+    int loops = 1;
+    PipelineMode pipeline = PIPELINE_THREADED;
+    BeamFormerConfig config;
+    bool compare = false;
+    BeamformerEngine reference = ENGINE_TIME_DOMAIN;
+    
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) {
+                outputFile = argv[++i];
+            }
+        } else if (arg == "-n" || arg == "--loops") {
+            if (i + 1 < argc) {
+                loops = std::max(1, std::stoi(argv[++i]));
+            }
+        } else if (arg == "-l" || arg == "--log") {
+            if (i + 1 < argc) {
+                loggingEnabled = std::stoi(argv[++i]) != 0;
+            }
+        } else if (arg == "-d" || arg == "--doa-interval") {
+            if (i + 1 < argc) {
+                config.doaInterval = std::max(1, std::stoi(argv[++i]));
+            }
+        } else if (arg == "-e" || arg == "--engine") {
+            if (i + 1 < argc) {
+                std::string engine = argv[++i];
+                if (!parseEngine(engine, config.engine)) {
+                    fprintf(stderr, "Unknown engine: %s\n", engine.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--compare") {
+            if (i + 1 < argc) {
+                std::string engine = argv[++i];
+                if (!parseEngine(engine, reference)) {
+                    fprintf(stderr, "Unknown engine: %s\n", engine.c_str());
+                    return 1;
+                }
+                compare = true;
+            }
+        } else if (arg == "--mvdr-interval") {
+            if (i + 1 < argc) {
+                config.mvdrInterval = std::max(1, std::stoi(argv[++i]));
+            }
+        } else if (arg == "--no-vad") {
+            config.vadEnabled = false;
+        } else if (arg == "--vad-idle") {
+            if (i + 1 < argc) {
+                config.vadIdleSeconds = std::max(0, std::stoi(argv[++i]));
+            }
+        } else if (arg == "--fft-plan") {
+            if (i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "estimate") {
+                    config.fftPlanMode = FFT_PLAN_ESTIMATE;
+                } else if (mode == "measure") {
+                    config.fftPlanMode = FFT_PLAN_MEASURE;
+                } else if (mode == "patient") {
+                    config.fftPlanMode = FFT_PLAN_PATIENT;
+                } else {
+                    fprintf(stderr, "Unknown FFT plan mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--fft-wisdom") {
+            if (i + 1 < argc) {
+                config.fftWisdomFile = argv[++i];
+            }
+        } else if (arg == "--io-mode") {
+            if (i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "event") {
+                    config.ioMode = IO_MODE_EVENT;
+                } else if (mode == "sleep") {
+                    config.ioMode = IO_MODE_SLEEP;
+                } else {
+                    fprintf(stderr, "Unknown I/O mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--pipeline") {
+            if (i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "threaded") {
+                    pipeline = PIPELINE_THREADED;
+                } else if (mode == "fused") {
+                    pipeline = PIPELINE_FUSED;
+                } else {
+                    fprintf(stderr, "Unknown pipeline mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--period") {
+            if (i + 1 < argc) {
+                config.frameSize = std::stoi(argv[++i]);
+                if (config.frameSize < MIN_FRAME_SIZE || config.frameSize > MAX_FRAME_SIZE) {
+                    fprintf(stderr, "Period must be %d-%d frames\n", MIN_FRAME_SIZE, MAX_FRAME_SIZE);
+                    return 1;
+                }
+            }
+        } else if (arg == "--ring-size") {
+            if (i + 1 < argc) {
+                config.ringSize = (size_t)std::max(1, std::stoi(argv[++i]));
+            }
+        } else if (arg == "--no-simd") {
+            setSimdEnabled(false);
+        } else if (arg == "--beams") {
+            if (i + 1 < argc) {
+                if (!parseIntList(argv[++i], config.beamAngles)) {
+                    fprintf(stderr, "Invalid --beams value: %s (expected angles like 0,90,180)\n", argv[i]);
+                    return 1;
+                }
+            }
+        } else if (arg == "--geometry") {
+            if (i + 1 < argc) {
+                std::string error;
+                if (!loadArrayGeometry(argv[++i], config.geometry, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            printf("Usage: %s [options] INPUT\n", argv[0]);
+            printf("INPUT is a WAV file with one channel per capture channel, or raw S16_LE at %d Hz\n", SAMPLE_RATE);
+            printf("Options:\n");
+            printf("  -o, --output FILE     Write the beamformed output as a WAV file, one channel per beam\n");
+            printf("  -n, --loops N         Play the input N times (default: 1)\n");
+            printf("  -l, --log VALUE       Enable logging (0=off, 1=on, default: 0)\n");
+            printf("  -d, --doa-interval N  Frames between DOA estimates (default: %d)\n", DEFAULT_DOA_INTERVAL);
+            printf("  -e, --engine TYPE     Beamformer engine: time, freq, mvdr or q15 (default: %s)\n",
+                   engineName(DEFAULT_ENGINE));
+            printf("  --compare ENGINE      Also report output error and DOA agreement against ENGINE\n");
+            printf("  --no-vad              Update DOA on every frame, not only while voice is active\n");
+            printf("  --vad-idle SECONDS    Silence before the unsteered passthrough, 0 = never (default: %d)\n",
+                   DEFAULT_VAD_IDLE_SECONDS);
+            printf("  --mvdr-interval N     Frames between MVDR weight solves (default: %d)\n", DEFAULT_MVDR_INTERVAL);
+            printf("  --fft-plan MODE       FFTW planning: estimate, measure or patient (default: measure)\n");
+            printf("  --fft-wisdom FILE     FFTW wisdom cache, empty to disable (default: %s)\n", DEFAULT_FFT_WISDOM_FILE);
+            printf("  --io-mode MODE        Wait on events or sleep-poll: event or sleep (default: event)\n");
+            printf("  --pipeline MODE       threaded (rings and threads) or fused (direct calls) (default: threaded)\n");
+            printf("  --period N            Frames per processing block, %d-%d (default: %d)\n",
+                   MIN_FRAME_SIZE, MAX_FRAME_SIZE, FRAME_SIZE);
+            printf("  --ring-size N         Samples per ring, rounded up to a power of 2 (default: %d)\n", BUFFER_SIZE);
+            printf("  --geometry FILE       Microphone array description (default: %d mics %.1f mm apart)\n",
+                   NUM_CHANNELS, MIC_DISTANCE * 1000);
+            printf("  --beams A,B,...       Also output fixed beams at these angles, one channel each after the tracked beam\n");
+            printf("  --no-simd             Use the scalar kernels even where NEON is available\n");
+            printf("  -h, --help            Show this help message\n");
+            return 0;
+        } else {
+            inputFile = arg;
+        }
+    }
+    
+    if (inputFile.empty()) {
+        fprintf(stderr, "No input file given, see --help\n");
+        return 1;
+    }
+    
+    // The file is finite, so wait for the sink rather than drop output
+    config.outputBackpressure = true;
+    
+    Logger logger(false, loggingEnabled);
+    ErrorHandler errorHandler(&logger);
+    PipelineStats stats(config.frameSize);
+    
+    size_t ringSize = ringSizeFor(config);
+    CircularBuffer sourceToBeamformer(ringSize, config.ioMode == IO_MODE_EVENT);
+    CircularBuffer beamformerToSink(ringSize, config.ioMode == IO_MODE_EVENT);
+    
+    FileSource source(inputFile, &sourceToBeamformer, &logger, loops, config.geometry.deviceChannels);
+    BeamFormer beamformer(&sourceToBeamformer, &beamformerToSink, &errorHandler, &logger, config, &stats);
+    FileSink sink(outputFile, &beamformerToSink, &logger, config.beamCount());
+    
+    if (!source.init() || !beamformer.init()) {
+        fprintf(stderr, "Failed to initialize benchmark\n");
+        return 1;
+    }
+    
+    std::chrono::steady_clock::time_point startTime, endTime;
+    size_t framesOut = 0;
+    
+    if (pipeline == PIPELINE_FUSED) {
+        // Call the beamformer directly, as the fused live pipeline does
+        WavWriter writer;
+        if (!outputFile.empty() && !writer.open(outputFile, config.beamCount(), SAMPLE_RATE)) {
+            fprintf(stderr, "Cannot create output file: %s\n", outputFile.c_str());
+            return 1;
+        }
+        
+        const std::vector<float>& samples = source.getSamples();
+        const size_t frameSamples = config.frameSize * config.geometry.deviceChannels;
+        std::vector<float> output(config.frameSize * config.beamCount());
+        
+        startTime = std::chrono::steady_clock::now();
+        for (int loop = 0; loop < loops; loop++) {
+            for (size_t offset = 0; offset + frameSamples <= samples.size(); offset += frameSamples) {
+                uint64_t startUs = PipelineStats::nowUs();
+                if (!beamformer.processFrame(samples.data() + offset, output.data())) {
+                    break;
+                }
+                stats.recordStage(STAGE_PROCESS, startUs);
+                
+                if (writer.isOpen()) {
+                    writer.write(output.data(), config.frameSize);
+                }
+                framesOut += config.frameSize;
+            }
+        }
+        endTime = std::chrono::steady_clock::now();
+    } else {
+        if (!sink.init()) {
+            fprintf(stderr, "Failed to initialize benchmark\n");
+            return 1;
+        }
+        
+        // Start the consumers first so the clock only covers the pipeline run
+        sink.start();
+        beamformer.start();
+        
+        startTime = std::chrono::steady_clock::now();
+        source.start();
+        
+        while (!sink.isFinished() && beamformer.getState() != STATE_ERROR) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        
+        endTime = std::chrono::steady_clock::now();
+        
+        source.stop();
+        beamformer.stop();
+        sink.stop();
+        framesOut = sink.getFramesWritten();
+    }
+    
+    if (beamformer.getState() == STATE_ERROR) {
+        fprintf(stderr, "Beamformer failed during the run\n");
+        return 1;
+    }
+    
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+    double audioSeconds = (double)source.totalFrames() / SAMPLE_RATE;
+    LatencyHistogram::Summary process = stats.latency[STAGE_PROCESS].summarize();
+    
+    printf("Input: %s, %zu frames x %d loops, engine %s, %s pipeline\n", inputFile.c_str(),
+           source.totalFrames() / loops, loops, engineName(config.engine),
+           pipeline == PIPELINE_FUSED ? "fused" : "threaded");
+    printf("Processed %u blocks of %d frames (%.2f s of audio) in %.3f s\n",
+           process.count, config.frameSize, audioSeconds, elapsed);
+    
+    if (elapsed > 0.0 && audioSeconds > 0.0) {
+        printf("Throughput: %.0f frames/s, real-time factor %.4f (%.1fx real time)\n",
+               source.totalFrames() / elapsed, elapsed / audioSeconds, audioSeconds / elapsed);
+    }
+    
+    printf("Per-block latency: p50 %u us, p99 %u us, max %u us (deadline %u us)\n",
+           process.p50Us, process.p99Us, process.maxUs, stats.deadlineUs);
+    printf("Deadline misses: %u, output ring overflows: %u\n",
+           stats.deadlineMisses.load(), stats.ringOverflows.load());
+    
+    if (!outputFile.empty()) {
+        printf("Wrote %zu frames to %s\n", framesOut, outputFile.c_str());
+        if (stats.ringOverflows.load() > 0) {
+            fprintf(stderr, "Output ring overflowed, %s is incomplete\n", outputFile.c_str());
+            return 1;
+        }
+    }
+    
+    if (compare && !compareEngines(config, reference, source.getSamples(), &errorHandler, &logger)) {
+        fprintf(stderr, "Engine comparison failed\n");
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,520 @@
+#include "beamformer.h"
+#include "config_file.h"
+#include "simd_utils.h"
+#include "worker_pool.h"
+#include <fftw3.h>
+#include <sys/utsname.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// Batches timed per result, the median is reported
+#define MICROBENCH_REPEATS 5
+#define MICROBENCH_DEFAULT_MS 300
+
+// Angle the steering benchmarks render, off broadside so the fractional
+// delays are exercised
+#define MICROBENCH_ANGLE 60
+
+// Frames run through a beamformer before its stages are timed, so the
+// delay lines, correlations and VAD have settled
+#define MICROBENCH_WARMUP_FRAMES 32
+
+// One measured case. Each iteration covers one processing frame, of
+// samplesPerFrame input samples; the optional fields are -1 when unused.
+struct MicrobenchResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerFrame;
+    int samplesPerFrame;
+    double planUs;              // FFTW planning time
+    double p50Ns, p99Ns, maxNs; // Spread of single handoffs
+    
+    MicrobenchResult(const std::string& n, uint64_t iters, double ns, int samples) :
+        name(n), iterations(iters), nsPerFrame(ns), samplesPerFrame(samples),
+        planUs(-1.0), p50Ns(-1.0), p99Ns(-1.0), maxNs(-1.0) {}
+    
+    double samplesPerSec() const { return nsPerFrame > 0.0 ? samplesPerFrame * 1e9 / nsPerFrame : 0.0; }
+};
+
+struct MicrobenchOptions {
+    int minTimeMs;
+    std::string filter;  // Only cases whose name contains this
+    
+    MicrobenchOptions() : minTimeMs(MICROBENCH_DEFAULT_MS) {}
+    bool selected(const std::string& name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+};
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Grow the batch until it fills its share of the time budget, then time
+// MICROBENCH_REPEATS batches and keep the median, which shrugs off the
+// odd preemption better than the mean
+template <typename Body>
+static MicrobenchResult measure(const std::string& name, int samplesPerFrame, const MicrobenchOptions& options,
+                                Body body) {
+    const double batchNs = options.minTimeMs * 1e6 / MICROBENCH_REPEATS;
+    body();
+    
+    uint64_t batch = 1;
+    for (;;) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < batch; i++) {
+            body();
+        }
+        double ns = elapsedNs(start);
+        if (ns >= batchNs || batch >= (1ull << 30)) {
+            break;
+        }
+        batch = ns > batchNs / 100 ? (uint64_t)(batch * batchNs / ns) + 1 : batch * 10;
+    }
+    
+    double perFrame[MICROBENCH_REPEATS];
+    for (int r = 0; r < MICROBENCH_REPEATS; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < batch; i++) {
+            body();
+        }
+        perFrame[r] = elapsedNs(start) / batch;
+    }
+    std::sort(perFrame, perFrame + MICROBENCH_REPEATS);
+    return MicrobenchResult(name, batch * MICROBENCH_REPEATS, perFrame[MICROBENCH_REPEATS / 2], samplesPerFrame);
+}
+
+// Deterministic test signal: a common noise source reaching each mic a
+// sample later than the previous one, plus a little uncorrelated noise
+static std::vector<float> makeInput(const BeamFormerConfig& config, int frames) {
+    const int channels = config.geometry.deviceChannels;
+    const size_t length = (size_t)frames * config.frameSize;
+    std::vector<float> samples(length * channels);
+    std::vector<float> source(length + channels);
+    uint32_t seed = 12345;
+    auto noise = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(int32_t)seed / 2147483648.0f;
+    };
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = 0.3f * noise();
+    }
+    for (size_t i = 0; i < length; i++) {
+        for (int c = 0; c < channels; c++) {
+            samples[i * channels + c] = source[i + channels - c] + 0.01f * noise();
+        }
+    }
+    return samples;
+}
+
+// Beamformer of one engine warmed up on the test signal, with the NEON
+// kernels as requested
+static std::unique_ptr<BeamFormer> makeBeamFormer(BeamFormerConfig config, BeamformerEngine engine, bool neon,
+                                                  DspCache* cache, ErrorHandler* errorHandler, Logger* logger) {
+    config.engine = engine;
+    config.vadEnabled = false;
+    config.doaInterval = 1;
+    config.fftPlanMode = FFT_PLAN_MEASURE;
+    config.fftWisdomFile = "";
+    
+    bool wasEnabled = simdEnabled();
+    setSimdEnabled(neon);
+    std::unique_ptr<BeamFormer> beamformer(new BeamFormer(nullptr, nullptr, errorHandler, logger, config));
+    setSimdEnabled(wasEnabled);
+    
+    beamformer->setDspCache(cache);
+    if (!beamformer->init()) {
+        return nullptr;
+    }
+    
+    std::vector<float> input = makeInput(config, MICROBENCH_WARMUP_FRAMES);
+    std::vector<float> output((size_t)config.frameSize * config.beamCount());
+    const size_t frameSamples = (size_t)config.frameSize * config.geometry.deviceChannels;
+    for (int f = 0; f < MICROBENCH_WARMUP_FRAMES; f++) {
+        if (!beamformer->processFrame(input.data() + f * frameSamples, output.data())) {
+            return nullptr;
+        }
+    }
+    return beamformer;
+}
+
+static bool benchDelaySum(const BeamFormerConfig& config, const MicrobenchOptions& options, DspCache* cache,
+                          ErrorHandler* errorHandler, Logger* logger, std::vector<MicrobenchResult>& results) {
+    const int mics = (int)config.geometry.mics.size();
+    const int angles[1] = {MICROBENCH_ANGLE};
+    std::vector<float> beam(config.frameSize);
+    float* outputs[1] = {beam.data()};
+    
+    const BeamformerEngine engines[2] = {ENGINE_TIME_DOMAIN, ENGINE_FIXED_POINT};
+    for (int e = 0; e < 2; e++) {
+        for (int neon = 0; neon <= (simdAvailable() ? 1 : 0); neon++) {
+            std::string name = std::string("delay_sum/") + (e == 0 ? "float" : "q15") + (neon ? "/neon" : "/scalar");
+            if (!options.selected(name)) {
+                continue;
+            }
+            std::unique_ptr<BeamFormer> beamformer = makeBeamFormer(config, engines[e], neon != 0, cache,
+                                                                    errorHandler, logger);
+            if (!beamformer) {
+                return false;
+            }
+            BeamFormer* bf = beamformer.get();
+            results.push_back(measure(name, config.frameSize * mics, options,
+                                      [bf, &angles, &outputs]() { bf->steerBeams(angles, outputs, 1); }));
+        }
+    }
+    return true;
+}
+
+// One transform per mic, as the frequency-domain engine runs each frame.
+// The complex-to-complex case is the alternative FFTW layout with the
+// imaginary parts zeroed, for comparison with the real-input plans used.
+static bool benchFft(const BeamFormerConfig& config, int fftSize, const MicrobenchOptions& options,
+                     std::vector<MicrobenchResult>& results) {
+    const int mics = (int)config.geometry.mics.size();
+    float* real = (float*)fftwf_malloc(sizeof(float) * fftSize);
+    fftwf_complex* in = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+    fftwf_complex* out = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+    bool ok = real && in && out;
+    
+    for (int complex = 0; ok && complex <= 1; complex++) {
+        for (int measured = 0; ok && measured <= 1; measured++) {
+            std::string name = std::string("fft/") + (complex ? "c2c" : "r2c") + (measured ? "/measure" : "/estimate");
+            if (!options.selected(name)) {
+                continue;
+            }
+            
+            // Forget earlier plans so MEASURE times its own search
+            fftwf_forget_wisdom();
+            unsigned flags = measured ? FFTW_MEASURE : FFTW_ESTIMATE;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            fftwf_plan plan = complex ? fftwf_plan_dft_1d(fftSize, in, out, FFTW_FORWARD, flags)
+                                      : fftwf_plan_dft_r2c_1d(fftSize, real, out, flags);
+            double planNs = elapsedNs(start);
+            if (!plan) {
+                ok = false;
+                break;
+            }
+            
+            // Planning may have overwritten the buffers
+            for (int i = 0; i < fftSize; i++) {
+                real[i] = (float)((i * 7919) % 1000) / 1000.0f - 0.5f;
+                in[i][0] = real[i];
+                in[i][1] = 0.0f;
+            }
+            
+            MicrobenchResult result = measure(name, config.frameSize * mics, options, [plan, mics]() {
+                for (int c = 0; c < mics; c++) {
+                    fftwf_execute(plan);
+                }
+            });
+            result.planUs = planNs / 1000.0;
+            results.push_back(result);
+            fftwf_destroy_plan(plan);
+        }
+    }
+    
+    if (real) fftwf_free(real);
+    if (in) fftwf_free(in);
+    if (out) fftwf_free(out);
+    return ok;
+}
+
+// The DOA search alone: pair correlations from the smoothed state and the
+// SRP scoring and refinement over the angle grid
+static bool benchDoa(const BeamFormerConfig& config, const MicrobenchOptions& options, DspCache* cache,
+                     ErrorHandler* errorHandler, Logger* logger, std::vector<MicrobenchResult>& results) {
+    const int mics = (int)config.geometry.mics.size();
+    const BeamformerEngine engines[2] = {ENGINE_FREQUENCY_DOMAIN, ENGINE_FIXED_POINT};
+    for (int e = 0; e < 2; e++) {
+        std::string name = e == 0 ? "doa/phat" : "doa/q15";
+        if (!options.selected(name)) {
+            continue;
+        }
+        std::unique_ptr<BeamFormer> beamformer = makeBeamFormer(config, engines[e], simdEnabled(), cache,
+                                                                errorHandler, logger);
+        if (!beamformer) {
+            return false;
+        }
+        BeamFormer* bf = beamformer.get();
+        results.push_back(measure(name, config.frameSize * mics, options, [bf]() { bf->estimateDirection(); }));
+    }
+    return true;
+}
+
+// Copying write and read of one frame on a single thread, then a producer
+// thread streaming frames to this one as fast as the ring allows
+static bool benchRingThroughput(const BeamFormerConfig& config, const MicrobenchOptions& options,
+                                std::vector<MicrobenchResult>& results) {
+    const size_t frameSamples = (size_t)config.frameSize * config.geometry.deviceChannels;
+    const size_t ringSize = ringSizeFor(config);
+    std::vector<float> frame(frameSamples, 0.25f);
+    std::vector<float> received(frameSamples);
+    
+    if (options.selected("ring/write_read")) {
+        CircularBuffer ring(ringSize, true);
+        CircularBuffer* r = &ring;
+        float* in = frame.data();
+        float* out = received.data();
+        results.push_back(measure("ring/write_read", (int)frameSamples, options, [r, in, out, frameSamples]() {
+            r->write(in, frameSamples);
+            r->read(out, frameSamples);
+        }));
+    }
+    
+    if (options.selected("ring/cross_thread")) {
+        CircularBuffer ring(ringSize, true);
+        std::atomic<bool> stop(false);
+        std::thread producer([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (ring.waitForWrite(frameSamples, 10)) {
+                    ring.write(frame.data(), frameSamples);
+                }
+            }
+            ring.close();
+        });
+        
+        // Frames received within the time budget, after a short start
+        uint64_t frames = 0;
+        std::chrono::steady_clock::time_point start;
+        while (frames <= MICROBENCH_WARMUP_FRAMES || elapsedNs(start) < options.minTimeMs * 1e6) {
+            if (!ring.waitForRead(frameSamples, 100) || ring.read(received.data(), frameSamples) < frameSamples) {
+                continue;
+            }
+            if (++frames == MICROBENCH_WARMUP_FRAMES) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+        double ns = elapsedNs(start);
+        stop = true;
+        while (ring.read(received.data(), frameSamples) > 0 || !ring.isClosed()) {
+        }
+        producer.join();
+        
+        frames -= MICROBENCH_WARMUP_FRAMES;
+        results.push_back(MicrobenchResult("ring/cross_thread", frames, ns / frames, (int)frameSamples));
+    }
+    return true;
+}
+
+// Ping-pong of one frame with an echo thread: half the round trip is the
+// time from write() until the waiting consumer holds the samples
+static bool benchRingHandoff(const BeamFormerConfig& config, bool eventDriven, const MicrobenchOptions& options,
+                             std::vector<MicrobenchResult>& results) {
+    std::string name = eventDriven ? "ring/handoff/event" : "ring/handoff/sleep";
+    if (!options.selected(name)) {
+        return true;
+    }
+    
+    const size_t frameSamples = (size_t)config.frameSize * config.geometry.deviceChannels;
+    const size_t ringSize = ringSizeFor(config);
+    CircularBuffer forward(ringSize, eventDriven);
+    CircularBuffer reply(ringSize, eventDriven);
+    
+    std::thread echo([&]() {
+        std::vector<float> frame(frameSamples);
+        for (;;) {
+            if (!forward.waitForRead(frameSamples, 100) && !forward.isClosed()) {
+                continue;
+            }
+            if (forward.read(frame.data(), frameSamples) < frameSamples) {
+                break;  // Closed
+            }
+            reply.write(frame.data(), frameSamples);
+        }
+    });
+    
+    std::vector<float> frame(frameSamples, 0.25f);
+    std::vector<double> oneWay;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int i = 0; ok && (i < MICROBENCH_WARMUP_FRAMES || elapsedNs(begin) < options.minTimeMs * 1e6); i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        forward.write(frame.data(), frameSamples);
+        ok = reply.waitForRead(frameSamples, 1000) && reply.read(frame.data(), frameSamples) == frameSamples;
+        double ns = elapsedNs(start) / 2;
+        if (i >= MICROBENCH_WARMUP_FRAMES) {
+            oneWay.push_back(ns);
+        }
+    }
+    forward.close();
+    echo.join();
+    if (!ok || oneWay.empty()) {
+        return false;
+    }
+    
+    double total = 0.0;
+    for (size_t i = 0; i < oneWay.size(); i++) {
+        total += oneWay[i];
+    }
+    std::sort(oneWay.begin(), oneWay.end());
+    MicrobenchResult result(name, oneWay.size(), total / oneWay.size(), (int)frameSamples);
+    result.p50Ns = oneWay[oneWay.size() / 2];
+    result.p99Ns = oneWay[std::min(oneWay.size() - 1, oneWay.size() * 99 / 100)];
+    result.maxNs = oneWay.back();
+    results.push_back(result);
+    return true;
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        char ch = text[i];
+        if (ch == '"' || ch == '\\') {
+            quoted += '\\';
+            quoted += ch;
+        } else if ((unsigned char)ch < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            quoted += escaped;
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "\"";
+}
+
+static void writeOptional(FILE* out, const char* key, double value) {
+    if (value >= 0.0) {
+        fprintf(out, ", \"%s\": %.1f", key, value);
+    }
+}
+
+static void writeJson(FILE* out, const std::string& label, const BeamFormerConfig& config, int fftSize,
+                      const std::vector<MicrobenchResult>& results) {
+    struct utsname host;
+    if (uname(&host) != 0) {
+        snprintf(host.nodename, sizeof(host.nodename), "unknown");
+        snprintf(host.machine, sizeof(host.machine), "unknown");
+        snprintf(host.release, sizeof(host.release), "unknown");
+    }
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"beamformer_microbench\",\n");
+    fprintf(out, "  \"label\": %s,\n", jsonString(label).c_str());
+    fprintf(out, "  \"timestamp\": \"%s\",\n", timestamp);
+    fprintf(out, "  \"host\": {\"name\": %s, \"machine\": %s, \"kernel\": %s, \"cpus\": %d, \"neon\": %s, "
+                 "\"compiler\": %s},\n",
+            jsonString(host.nodename).c_str(), jsonString(host.machine).c_str(), jsonString(host.release).c_str(),
+            WorkerPool::onlineCpus(), simdAvailable() ? "true" : "false", jsonString(__VERSION__).c_str());
+    fprintf(out, "  \"config\": {\"sample_rate\": %d, \"frame_size\": %d, \"mics\": %d, \"channels\": %d, "
+                 "\"fft_size\": %d, \"geometry\": %s},\n",
+            SAMPLE_RATE, config.frameSize, (int)config.geometry.mics.size(), config.geometry.deviceChannels,
+            fftSize, jsonString(config.geometry.describe()).c_str());
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicrobenchResult& r = results[i];
+        fprintf(out, "    {\"name\": %s, \"iterations\": %llu, \"ns_per_frame\": %.1f, \"samples_per_frame\": %d, "
+                     "\"samples_per_sec\": %.0f",
+                jsonString(r.name).c_str(), (unsigned long long)r.iterations, r.nsPerFrame, r.samplesPerFrame,
+                r.samplesPerSec());
+        writeOptional(out, "plan_us", r.planUs);
+        writeOptional(out, "p50_ns", r.p50Ns);
+        writeOptional(out, "p99_ns", r.p99Ns);
+        writeOptional(out, "max_ns", r.maxNs);
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+// Microbenchmarks of the DSP kernels and ring buffer, reported as JSON for
+// tracking across releases and boards
+int main(int argc, char* argv[]) {
+    std::string outputFile;  // Empty for stdout
+    std::string label;
+    MicrobenchOptions options;
+    BeamFormerConfig config;
+    
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) {
+                outputFile = argv[++i];
+            }
+        } else if (arg == "-t" || arg == "--time") {
+            if (i + 1 < argc) {
+                options.minTimeMs = std::max(MICROBENCH_REPEATS, std::stoi(argv[++i]));
+            }
+        } else if (arg == "-f" || arg == "--filter") {
+            if (i + 1 < argc) {
+                options.filter = argv[++i];
+            }
+        } else if (arg == "--label") {
+            if (i + 1 < argc) {
+                label = argv[++i];
+            }
+        } else if (arg == "--period") {
+            if (i + 1 < argc) {
+                config.frameSize = std::stoi(argv[++i]);
+                if (config.frameSize < MIN_FRAME_SIZE || config.frameSize > MAX_FRAME_SIZE) {
+                    fprintf(stderr, "Period must be %d-%d frames\n", MIN_FRAME_SIZE, MAX_FRAME_SIZE);
+                    return 1;
+                }
+            }
+        } else if (arg == "--geometry") {
+            if (i + 1 < argc) {
+                std::string error;
+                if (!loadArrayGeometry(argv[++i], config.geometry, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            printf("Usage: %s [options]\n", argv[0]);
+            printf("Times the DSP kernels and ring buffer and prints the results as JSON\n");
+            printf("Options:\n");
+            printf("  -o, --output FILE     Write the JSON to FILE instead of stdout\n");
+            printf("  -t, --time MS         Time budget per case (default: %d)\n", MICROBENCH_DEFAULT_MS);
+            printf("  -f, --filter TEXT     Only run cases whose name contains TEXT, e.g. fft/ or ring/\n");
+            printf("  --label TEXT          Free-form tag stored with the results, e.g. a release or board\n");
+            printf("  --period N            Frames per processing block, %d-%d (default: %d)\n",
+                   MIN_FRAME_SIZE, MAX_FRAME_SIZE, FRAME_SIZE);
+            printf("  --geometry FILE       Microphone array description (default: %d mics %.1f mm apart)\n",
+                   NUM_CHANNELS, MIC_DISTANCE * 1000);
+            printf("  -h, --help            Show this help message\n");
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s, see --help\n", arg.c_str());
+            return 1;
+        }
+    }
+    
+    Logger logger(false, false);
+    ErrorHandler errorHandler(&logger);
+    DspCache cache;
+    std::vector<MicrobenchResult> results;
+    
+    // The FFT size the beamformer derives from the period
+    BeamFormer sizing(nullptr, nullptr, &errorHandler, &logger, config);
+    const int fftSize = sizing.getFftSize();
+    
+    if (!benchDelaySum(config, options, &cache, &errorHandler, &logger, results) ||
+        !benchFft(config, fftSize, options, results) ||
+        !benchDoa(config, options, &cache, &errorHandler, &logger, results) ||
+        !benchRingThroughput(config, options, results) ||
+        !benchRingHandoff(config, true, options, results) ||
+        !benchRingHandoff(config, false, options, results)) {
+        fprintf(stderr, "Microbenchmark failed\n");
+        return 1;
+    }
+    
+    FILE* out = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Cannot create output file: %s\n", outputFile.c_str());
+        return 1;
+    }
+    writeJson(out, label, config, fftSize, results);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
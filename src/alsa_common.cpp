@@ -1,19 +1,36 @@
 #include "alsa_common.h"
 #include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 AlsaDevice::AlsaDevice(const std::string& dev, unsigned int rate, unsigned int chans,
-                     ErrorHandler* errHandler, Logger* log) : 
+                     ErrorHandler* errHandler, Logger* log, PipelineStats* st) : 
     handle(nullptr),
     device(dev),
     sampleRate(rate),
     channels(chans),
     format(SND_PCM_FORMAT_S16_LE),
+    requestedFormat(SAMPLE_FORMAT_AUTO),
+    sampleFormat(SAMPLE_FORMAT_S16),
     periodSize(FRAME_SIZE),
-    bufferSize(FRAME_SIZE * 8),
+    bufferSize(FRAME_SIZE * DEFAULT_PERIODS),
+    periodCount(DEFAULT_PERIODS),
     running(false),
     state(STATE_INIT),
     errorHandler(errHandler),
-    logger(log) {
+    logger(log),
+    stats(st),
+    ioMode(IO_MODE_EVENT),
+    stream(SND_PCM_STREAM_CAPTURE),
+    useMmap(false),
+    mmapAccess(false),
+    mmapOffset(0),
+    mmapFrames(0),
+    scratch(nullptr),
+    restartFailures(0) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 }
 
 AlsaDevice::~AlsaDevice() {
@@ -22,18 +39,134 @@ AlsaDevice::~AlsaDevice() {
         snd_pcm_close(handle);
         handle = nullptr;
     }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
+}
+
+bool AlsaDevice::setupPolling() {
+    if (ioMode != IO_MODE_EVENT) {
+        return true;
+    }
+    
+    if (wakeFd < 0) {
+        logger->log(LOG_WARNING, "Cannot create wakeup eventfd, falling back to blocking I/O");
+        ioMode = IO_MODE_SLEEP;
+        return true;
+    }
+    
+    int err;
+    if ((err = snd_pcm_nonblock(handle, 1)) < 0) {
+        logger->log(LOG_ERR, "Cannot set non-blocking mode: " + std::string(snd_strerror(err)));
+        return false;
+    }
+    
+    int count = snd_pcm_poll_descriptors_count(handle);
+    if (count <= 0) {
+        logger->log(LOG_ERR, "Cannot get poll descriptor count");
+        return false;
+    }
+    
+    pollFds.resize(count + 1);
+    if ((err = snd_pcm_poll_descriptors(handle, pollFds.data(), count)) < 0) {
+        logger->log(LOG_ERR, "Cannot get poll descriptors: " + std::string(snd_strerror(err)));
+        return false;
+    }
+    
+    pollFds[count].fd = wakeFd;
+    pollFds[count].events = POLLIN;
+    pollFds[count].revents = 0;
+    
+    logger->log(LOG_INFO, "Event-driven I/O on " + std::to_string(count) + " poll descriptors");
+    return true;
+}
+
+bool AlsaDevice::waitForDevice(int timeoutMs) {
+    if (ioMode != IO_MODE_EVENT) {
+        // Blocking RW calls wait by themselves, mmap transfers need an explicit wait
+        return mmapAccess ? snd_pcm_wait(handle, timeoutMs) != 0 : true;
+    }
+    
+    unsigned int count = pollFds.size() - 1;
+    if (poll(pollFds.data(), pollFds.size(), timeoutMs) <= 0) {
+        return false;
+    }
+    
+    if (pollFds[count].revents & POLLIN) {
+        eventfd_t counter;
+        eventfd_read(wakeFd, &counter);
+        return false;
+    }
+    
+    // Let ALSA translate the raw events; errors surface from the transfer call
+    unsigned short revents = 0;
+    snd_pcm_poll_descriptors_revents(handle, pollFds.data(), count, &revents);
+    return (revents & (POLLIN | POLLOUT | POLLERR)) != 0;
+}
+
+void AlsaDevice::waitForWake(int timeoutMs) {
+    if (wakeFd < 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+    
+    struct pollfd pfd;
+    pfd.fd = wakeFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeoutMs) > 0) {
+        eventfd_t counter;
+        eventfd_read(wakeFd, &counter);
+    }
+}
+
+void AlsaDevice::wake() {
+    if (wakeFd >= 0) {
+        eventfd_write(wakeFd, 1);
+    }
+}
+
+void AlsaDevice::prepareScratch() {
+    if (!scratch) {
+        ownScratch.assign(periodSize * channels, 0.0f);
+        scratch = ownScratch.data();
+    }
+}
+
+bool AlsaDevice::restartStream() {
+    // Whatever state the PCM is stuck in, prepare only works from a stopped one
+    snd_pcm_drop(handle);
+    int err = snd_pcm_prepare(handle);
+    if (err < 0) {
+        if (restartFailures++ == 0) {
+            logger->logf(LOG_ERR, "Cannot re-prepare PCM: %s, retrying", snd_strerror(err));
+        }
+        return false;
+    }
+    
+    // Without readi() nothing starts a capture stream implicitly
+    if (stream == SND_PCM_STREAM_CAPTURE) {
+        snd_pcm_start(handle);
+    }
+    
+    logger->logf(LOG_WARNING, "PCM restarted after %u failed attempts", restartFailures);
+    restartFailures = 0;
+    if (stats) PipelineStats::increment(stats->recoveries);
+    state = STATE_RUNNING;
+    return true;
 }
 
 int AlsaDevice::xrunRecovery(int err) {
     if (err == -EPIPE) {  // Underrun
-        logger->log(LOG_WARNING, "ALSA xrun (underrun)");
+        logger->logf(LOG_WARNING, "ALSA xrun (underrun)");
+        if (stats) PipelineStats::increment(stats->xruns);
         err = snd_pcm_prepare(handle);
         if (err < 0) {
-            logger->log(LOG_ERR, "Can't recover from underrun: " + std::string(snd_strerror(err)));
+            logger->logf(LOG_ERR, "Can't recover from underrun: %s", snd_strerror(err));
         }
         return err;
     } else if (err == -ESTRPIPE) {  // Suspended
-        logger->log(LOG_WARNING, "ALSA suspend event");
+        logger->logf(LOG_WARNING, "ALSA suspend event");
         
         // Wait until suspend flag is released
         while ((err = snd_pcm_resume(handle)) == -EAGAIN) {
@@ -43,7 +176,7 @@ int AlsaDevice::xrunRecovery(int err) {
         if (err < 0) {
             err = snd_pcm_prepare(handle);
             if (err < 0) {
-                logger->log(LOG_ERR, "Can't recover from suspend: " + std::string(snd_strerror(err)));
+                logger->logf(LOG_ERR, "Can't recover from suspend: %s", snd_strerror(err));
             }
         }
         return err;
@@ -52,6 +185,141 @@ int AlsaDevice::xrunRecovery(int err) {
     return err;
 }
 
+int AlsaDevice::mmapWait(snd_pcm_uframes_t frames) {
+    while (running) {
+        snd_pcm_state_t pcmState = snd_pcm_state(handle);
+        
+        if (pcmState == SND_PCM_STATE_XRUN || pcmState == SND_PCM_STATE_SUSPENDED) {
+            int err = xrunRecovery(pcmState == SND_PCM_STATE_XRUN ? -EPIPE : -ESTRPIPE);
+            if (err < 0) {
+                return err;
+            }
+            continue;
+        }
+        
+        // Without readi() nothing starts a capture stream implicitly
+        if (pcmState == SND_PCM_STATE_PREPARED && stream == SND_PCM_STREAM_CAPTURE) {
+            snd_pcm_start(handle);
+        }
+        
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail < 0) {
+            int err = xrunRecovery(avail);
+            if (err < 0) {
+                return err;
+            }
+            continue;
+        }
+        
+        if ((snd_pcm_uframes_t)avail >= frames) {
+            return 1;
+        }
+        
+        waitForDevice(100);
+    }
+    
+    return 0;
+}
+
+int AlsaDevice::mmapMap(char** data, snd_pcm_uframes_t* frames) {
+    const snd_pcm_channel_area_t* areas;
+    
+    int err = snd_pcm_mmap_begin(handle, &areas, &mmapOffset, frames);
+    if (err < 0) {
+        return err;
+    }
+    
+    // Interleaved: every channel shares one area, frames are 'step' bits apart
+    *data = (char*)areas[0].addr + areas[0].first / 8 + mmapOffset * (areas[0].step / 8);
+    mmapFrames = *frames;
+    return 0;
+}
+
+int AlsaDevice::mmapCommit() {
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, mmapOffset, mmapFrames);
+    bool complete = committed == (snd_pcm_sframes_t)mmapFrames;
+    mmapFrames = 0;
+    
+    if (committed < 0) {
+        return committed;
+    }
+    if (!complete) {
+        return -EPIPE;
+    }
+    
+    // Playback starts once data is queued, as writei() would do at the start threshold
+    if (stream == SND_PCM_STREAM_PLAYBACK && snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) {
+        snd_pcm_start(handle);
+    }
+    return 0;
+}
+
+snd_pcm_sframes_t AlsaDevice::mmapTransfer(float* data) {
+    snd_pcm_uframes_t done = 0;
+    
+    while (done < periodSize) {
+        int err = mmapWait(periodSize - done);
+        if (err <= 0) {
+            if (err < 0) state = STATE_ERROR;
+            return err < 0 ? err : (snd_pcm_sframes_t)done;
+        }
+        
+        char* area = nullptr;
+        snd_pcm_uframes_t frames = periodSize - done;
+        if ((err = mmapMap(&area, &frames)) < 0 || frames == 0) {
+            if (err < 0 && (err = xrunRecovery(err)) < 0) {
+                state = STATE_ERROR;
+                return err;
+            }
+            continue;
+        }
+        
+        if (stream == SND_PCM_STREAM_CAPTURE) {
+            convertToFloat(sampleFormat, area, data + done * channels, frames * channels);
+        } else {
+            convertFromFloat(sampleFormat, data + done * channels, area, frames * channels);
+        }
+        
+        if ((err = mmapCommit()) < 0) {
+            if ((err = xrunRecovery(err)) < 0) {
+                state = STATE_ERROR;
+                return err;
+            }
+            // Captured frames before the overrun are not contiguous with what follows
+            if (stream == SND_PCM_STREAM_CAPTURE) {
+                done = 0;
+            }
+            continue;
+        }
+        
+        done += frames;
+    }
+    
+    return done;
+}
+
+bool AlsaDevice::negotiateFormat(snd_pcm_hw_params_t *hw_params) {
+    static const SampleFormat preference[] = { SAMPLE_FORMAT_S32, SAMPLE_FORMAT_S24, SAMPLE_FORMAT_S16 };
+    
+    for (SampleFormat candidate : preference) {
+        if (requestedFormat != SAMPLE_FORMAT_AUTO && candidate != requestedFormat) {
+            continue;
+        }
+        
+        snd_pcm_format_t alsaFormat = candidate == SAMPLE_FORMAT_S32 ? SND_PCM_FORMAT_S32_LE :
+                                      candidate == SAMPLE_FORMAT_S24 ? SND_PCM_FORMAT_S24_LE : SND_PCM_FORMAT_S16_LE;
+        if (snd_pcm_hw_params_test_format(handle, hw_params, alsaFormat) == 0) {
+            format = alsaFormat;
+            sampleFormat = candidate;
+            return true;
+        }
+    }
+    
+    logger->log(LOG_ERR, "Device " + device + " supports none of the requested sample formats (" +
+               std::string(sampleFormatName(requestedFormat)) + ")");
+    return false;
+}
+
 bool AlsaDevice::initAlsaParams(snd_pcm_stream_t streamType, snd_pcm_hw_params_t *hw_params) {
     int err;
     
@@ -67,13 +335,30 @@ bool AlsaDevice::initAlsaParams(snd_pcm_stream_t streamType, snd_pcm_hw_params_t
         return false;
     }
     
-    // Set access type to interleaved
-    if ((err = snd_pcm_hw_params_set_access(handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+    stream = streamType;
+    
+    // Set access type to interleaved, through mmap if requested and supported
+    snd_pcm_access_t access = SND_PCM_ACCESS_RW_INTERLEAVED;
+    if (useMmap) {
+        if (snd_pcm_hw_params_test_access(handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0) {
+            access = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+        } else {
+            logger->log(LOG_WARNING, "Device " + device + " does not support mmap access, using read/write");
+        }
+    }
+    
+    if ((err = snd_pcm_hw_params_set_access(handle, hw_params, access)) < 0) {
         logger->log(LOG_ERR, "Cannot set access type: " + std::string(snd_strerror(err)));
         return false;
     }
     
-    // Set format to S16_LE
+    mmapAccess = access == SND_PCM_ACCESS_MMAP_INTERLEAVED;
+    
+    // Widest integer format the device takes, converted to float at the edge
+    if (!negotiateFormat(hw_params)) {
+        return false;
+    }
+    
     if ((err = snd_pcm_hw_params_set_format(handle, hw_params, format)) < 0) {
         logger->log(LOG_ERR, "Cannot set sample format: " + std::string(snd_strerror(err)));
         return false;
@@ -98,15 +383,19 @@ bool AlsaDevice::initAlsaParams(snd_pcm_stream_t streamType, snd_pcm_hw_params_t
         return false;
     }
     
-    // Set period and buffer sizes
-    unsigned int periods = 4;
-    if ((err = snd_pcm_hw_params_set_periods_near(handle, hw_params, &periods, &dir)) < 0) {
-        logger->log(LOG_WARNING, "Cannot set periods: " + std::string(snd_strerror(err)));
+    // Set period and buffer sizes. The period is fixed first so the device
+    // wakes once per processing frame, the buffer follows as a period count.
+    snd_pcm_uframes_t requestedPeriod = periodSize;
+    snd_pcm_uframes_t period = periodSize;
+    dir = 0;
+    if ((err = snd_pcm_hw_params_set_period_size_near(handle, hw_params, &period, &dir)) < 0) {
+        logger->log(LOG_WARNING, "Cannot set period size: " + std::string(snd_strerror(err)));
     }
     
-    snd_pcm_uframes_t bufSize = periodSize * 8;
-    if ((err = snd_pcm_hw_params_set_buffer_size_near(handle, hw_params, &bufSize)) < 0) {
-        logger->log(LOG_WARNING, "Cannot set buffer size: " + std::string(snd_strerror(err)));
+    unsigned int periods = periodCount;
+    dir = 0;
+    if ((err = snd_pcm_hw_params_set_periods_near(handle, hw_params, &periods, &dir)) < 0) {
+        logger->log(LOG_WARNING, "Cannot set periods: " + std::string(snd_strerror(err)));
     }
     
     // Apply hardware parameters
@@ -125,8 +414,17 @@ bool AlsaDevice::initAlsaParams(snd_pcm_stream_t streamType, snd_pcm_hw_params_t
         logger->log(LOG_WARNING, "Cannot get buffer size: " + std::string(snd_strerror(err)));
     }
     
+    if (periodSize != requestedPeriod) {
+        logger->log(LOG_WARNING, "Device " + device + " period " + std::to_string(periodSize) +
+                   " differs from requested " + std::to_string(requestedPeriod));
+    }
+    
+    // Staging area for read/write access, sized once so transfers never allocate
+    deviceBuffer.assign(periodSize * channels * sampleFormatBytes(sampleFormat), 0);
+    
     logger->log(LOG_INFO, "ALSA configured with: rate=" + std::to_string(sampleRate) + 
-               " Hz, channels=" + std::to_string(channels) + 
+               " Hz, format=" + std::string(sampleFormatName(sampleFormat)) +
+               ", channels=" + std::to_string(channels) + 
                ", period=" + std::to_string(periodSize) + 
                ", buffer=" + std::to_string(bufferSize));
                
@@ -5,9 +5,14 @@
 #include <thread>
 #include <atomic>
 #include <string>
+#include <vector>
+#include <poll.h>
 #include "beamformer_defs.h"
 #include "error_handler.h"
 #include "logger.h"
+#include "pipeline_stats.h"
+#include "rt_utils.h"
+#include "sample_convert.h"
 
 class AlsaDevice {
 protected:
@@ -16,8 +21,12 @@ protected:
     unsigned int sampleRate;
     unsigned int channels;
     snd_pcm_format_t format;
+    SampleFormat requestedFormat;        // AUTO picks the widest the device accepts
+    SampleFormat sampleFormat;           // Negotiated
+    std::vector<char> deviceBuffer;      // One period in device format, for read/write access
     snd_pcm_uframes_t periodSize;
     snd_pcm_uframes_t bufferSize;
+    unsigned int periodCount;
     
     std::thread deviceThread;
     std::atomic<bool> running;
@@ -25,24 +34,110 @@ protected:
     
     ErrorHandler* errorHandler;
     Logger* logger;
+    PipelineStats* stats;  // Optional, may be null
+    ThreadRtConfig rtConfig;
+    
+    // Event-driven I/O: the PCM runs non-blocking and the device thread
+    // sleeps in poll() on its descriptors plus an eventfd used by stop()
+    IoMode ioMode;
+    int wakeFd;
+    std::vector<struct pollfd> pollFds;  // PCM descriptors followed by wakeFd
+    
+    // mmap access: periods are converted straight from/to the DMA buffer
+    snd_pcm_stream_t stream;
+    bool useMmap;                        // Requested, falls back to RW when unsupported
+    bool mmapAccess;                     // Negotiated
+    snd_pcm_uframes_t mmapOffset;        // Area mapped by mmapMap(), committed by mmapCommit()
+    snd_pcm_uframes_t mmapFrames;
+    
+    // One period of float samples for the device thread, from the app's
+    // frame arena or allocated by prepareScratch() when none was given
+    float* scratch;
+    std::vector<float> ownScratch;
+    
+    unsigned restartFailures;  // Consecutive failed restartStream() calls
 
     // Common ALSA error recovery
     int xrunRecovery(int err);
     
     // Common initialization steps
     bool initAlsaParams(snd_pcm_stream_t streamType, snd_pcm_hw_params_t *hw_params);
+    bool negotiateFormat(snd_pcm_hw_params_t *hw_params);
+    
+    // Switch to non-blocking mode and collect poll descriptors (event mode only)
+    bool setupPolling();
+    
+    // Wait until the PCM is ready for a transfer. Returns true when it is (or
+    // immediately in sleep mode, where the blocking call does the waiting),
+    // false on timeout or when woken by stop().
+    bool waitForDevice(int timeoutMs);
+    
+    // mmap helpers. mmapWait() waits until 'frames' can be transferred,
+    // recovering from xruns and starting the stream as needed; it returns 1
+    // when ready, 0 when stopping or a negative error.
+    int mmapWait(snd_pcm_uframes_t frames);
+    int mmapMap(char** data, snd_pcm_uframes_t* frames);
+    int mmapCommit();
+    
+    // Convert a period of float samples from (capture) or to (playback) the
+    // DMA buffer in as many pieces as needed. Returns frames transferred
+    // (short only when stopping) or a negative error.
+    snd_pcm_sframes_t mmapTransfer(float* data);
+    
+    // Idle for up to timeoutMs, returning early when woken by stop()
+    void waitForWake(int timeoutMs);
+    void wake();
+    
+    // Make sure scratch holds a period, called before the device runs
+    void prepareScratch();
     
 public:
     AlsaDevice(const std::string& dev, unsigned int rate, unsigned int chans,
-               ErrorHandler* errHandler, Logger* log);
+               ErrorHandler* errHandler, Logger* log, PipelineStats* st = nullptr);
     virtual ~AlsaDevice();
     
     bool isRunning() const { return running; }
     AppState getState() const { return state; }
     void setState(AppState newState) { state = newState; }
     
+    // Scheduling for the device thread, applied when it starts
+    void setRtConfig(const ThreadRtConfig& rt) { rtConfig = rt; }
+    
+    // Must be set before init()
+    void setIoMode(IoMode mode) { ioMode = mode; }
+    void setMmap(bool enable) { useMmap = enable; }
+    void setPeriodSize(snd_pcm_uframes_t frames, unsigned int periods) {
+        periodSize = frames;
+        periodCount = periods;
+        bufferSize = frames * periods;
+    }
+    void setChannels(unsigned int chans) { channels = chans; }
+    unsigned int getChannels() const { return channels; }
+    unsigned int getSampleRate() const { return sampleRate; }
+    
+    // Negotiated by init(), may differ from the request
+    snd_pcm_uframes_t getPeriodSize() const { return periodSize; }
+    snd_pcm_uframes_t getBufferSize() const { return bufferSize; }
+    bool isMmap() const { return mmapAccess; }
+    void setSampleFormat(SampleFormat fmt) { requestedFormat = fmt; }
+    SampleFormat getSampleFormat() const { return sampleFormat; }
+    
+    // Period buffer (periodSize * channels floats) owned by the caller, set
+    // after init() and before start()
+    void setScratch(float* buffer) { scratch = buffer; }
+    
     virtual bool init() = 0;
     virtual bool start() = 0;
+    
+    // Recover this PCM alone after a fatal error (STATE_ERROR): drop and
+    // re-prepare it, restart capture. Called by the thread driving the
+    // device, real-time safe. False while the device refuses, retry after
+    // RECOVERY_RETRY_MS.
+    virtual bool restartStream();
+    
+    // Mark the device running without its own thread, for a caller that
+    // drives readPeriod()/writePeriod() itself (fused pipeline)
+    bool startExternal() { prepareScratch(); running = true; return true; }
     virtual void stop() {}  // Changed from pure virtual to virtual with empty implementation
 };
 
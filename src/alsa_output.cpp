@@ -3,9 +3,10 @@
 #include <algorithm>
 
 AlsaOutput::AlsaOutput(const std::string& dev, CircularBuffer* inBuf, 
-                     ErrorHandler* errHandler, Logger* log) : 
-    AlsaDevice(dev, SAMPLE_RATE, 1, errHandler, log), // 1 channel for mono output
-    inputBuffer(inBuf) {
+                     ErrorHandler* errHandler, Logger* log, PipelineStats* st) : 
+    AlsaDevice(dev, SAMPLE_RATE, 1, errHandler, log, st), // Mono unless setChannels() asks for one per beam
+    inputBuffer(inBuf),
+    sourceRate(SAMPLE_RATE) {
 }
 
 AlsaOutput::~AlsaOutput() {
@@ -62,6 +63,10 @@ bool AlsaOutput::init() {
         return false;
     }
     
+    if (!setupPolling()) {
+        return false;
+    }
+    
     state = STATE_RUNNING;
     logger->log(LOG_INFO, "Audio output initialized successfully");
     return true;
@@ -72,6 +77,7 @@ bool AlsaOutput::start() {
         return true;
     }
     
+    prepareScratch();
     running = true;
     deviceThread = std::thread(&AlsaOutput::outputLoop, this);
     
@@ -85,72 +91,68 @@ void AlsaOutput::stop() {
     }
     
     running = false;
+    wake();
     
     if (deviceThread.joinable()) {
         deviceThread.join();
     }
     
-    // Drain any remaining data
+    // Drain any remaining data, which only waits on a blocking PCM
+    if (ioMode == IO_MODE_EVENT) {
+        snd_pcm_nonblock(handle, 0);
+    }
     snd_pcm_drain(handle);
     
     logger->log(LOG_INFO, "Audio output stopped");
 }
 
-void AlsaOutput::outputLoop() {
-    int err;
-    std::vector<int16_t> buffer(periodSize);
+snd_pcm_sframes_t AlsaOutput::writePeriod(const float* data) {
+    // Convert straight into the DMA buffer, data is only read for playback
+    if (mmapAccess) {
+        return mmapTransfer(const_cast<float*>(data));
+    }
     
-    logger->log(LOG_INFO, "Output thread started, writing " + std::to_string(periodSize) + " frames per period");
+    const size_t frameBytes = channels * sampleFormatBytes(sampleFormat);
+    convertFromFloat(sampleFormat, data, deviceBuffer.data(), periodSize * channels);
     
-    // Pre-buffer some silence to prevent initial underruns
-    std::vector<int16_t> silence(periodSize, 0);
-    for (int i = 0; i < 2; i++) {
-        snd_pcm_writei(handle, silence.data(), periodSize);
-    }
+    int err;
+    snd_pcm_uframes_t offset = 0;
+    bool recovered = false;
     
-    while (running) {
-        if (state == STATE_ERROR || state == STATE_RECOVERY || state == STATE_TERMINATING) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // A non-blocking PCM may take the period in several pieces
+    while (offset < periodSize && running) {
+        if (!waitForDevice(100)) {
             continue;
         }
         
-        // Read processed samples from the input buffer
-        size_t read = inputBuffer->read(buffer.data(), periodSize);
+        // Write to audio device
+        snd_pcm_sframes_t frames = snd_pcm_writei(handle, deviceBuffer.data() + offset * frameBytes, periodSize - offset);
         
-        if (read < periodSize) {
-            if (inputBuffer->isClosed()) {
-                logger->log(LOG_INFO, "Input buffer closed, exiting output loop");
-                break;
-            }
-            
-            // Not enough data, pad with silence and avoid playing partial buffers
-            if (read > 0) {
-                logger->log(LOG_WARNING, "Buffer underrun in output, padding with silence");
-                // Fill remaining buffer with silence
-                std::fill(buffer.begin() + read, buffer.end(), 0);
-            } else {
-                // No data at all, wait a bit and try again
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
+        if (frames == -EAGAIN) {
+            continue;
         }
         
-        // Write to audio device
-        snd_pcm_sframes_t frames = snd_pcm_writei(handle, buffer.data(), periodSize);
-        
         if (frames < 0) {
-            logger->log(LOG_WARNING, "ALSA write error: " + std::string(snd_strerror(frames)));
+            // Only one recovery per period, a second failure is fatal
+            if (recovered) {
+                logger->logf(LOG_ERR, "Failed to write after recovery: %s", snd_strerror(frames));
+                state = STATE_ERROR;
+                return frames;
+            }
+            
+            logger->logf(LOG_WARNING, "ALSA write error: %s", snd_strerror(frames));
             
             if (frames == -EPIPE) {  // Underrun
-                logger->log(LOG_WARNING, "ALSA buffer underrun");
+                logger->logf(LOG_WARNING, "ALSA buffer underrun");
+                if (stats) PipelineStats::increment(stats->xruns);
                 
                 if ((err = snd_pcm_recover(handle, frames, 1)) < 0) {
-                    logger->log(LOG_ERR, "Cannot recover from underrun: " + std::string(snd_strerror(err)));
+                    logger->logf(LOG_ERR, "Cannot recover from underrun: %s", snd_strerror(err));
                     state = STATE_ERROR;
-                    continue;
+                    return err;
                 }
             } else if (frames == -ESTRPIPE) {  // Suspended
-                logger->log(LOG_WARNING, "ALSA suspended");
+                logger->logf(LOG_WARNING, "ALSA suspended");
                 
                 while ((err = snd_pcm_resume(handle)) == -EAGAIN) {
                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -158,35 +160,150 @@ void AlsaOutput::outputLoop() {
                 
                 if (err < 0) {
                     if ((err = snd_pcm_prepare(handle)) < 0) {
-                        logger->log(LOG_ERR, "Cannot recover from suspend: " + std::string(snd_strerror(err)));
+                        logger->logf(LOG_ERR, "Cannot recover from suspend: %s", snd_strerror(err));
                         state = STATE_ERROR;
-                        continue;
+                        return err;
                     }
                 }
             } else {
                 // Some other error, try to recover
                 if ((err = snd_pcm_recover(handle, frames, 1)) < 0) {
-                    logger->log(LOG_ERR, "Cannot recover from error: " + std::string(snd_strerror(err)));
+                    logger->logf(LOG_ERR, "Cannot recover from error: %s", snd_strerror(err));
                     state = STATE_ERROR;
-                    continue;
+                    return err;
                 }
             }
             
             // Retry after recovery
-            frames = snd_pcm_writei(handle, buffer.data(), periodSize);
-            if (frames < 0) {
-                logger->log(LOG_ERR, "Failed to write after recovery: " + std::string(snd_strerror(frames)));
-                state = STATE_ERROR;
+            recovered = true;
+            continue;
+        }
+        
+        offset += frames;
+    }
+    
+    if (offset < periodSize) {
+        logger->logf(LOG_WARNING, "Short write: %lu frames of %lu", offset, periodSize);
+    } else {
+        logger->logf(LOG_INFO, "Wrote %lu frames to audio output", offset);
+    }
+    
+    return offset;
+}
+
+void AlsaOutput::prebuffer() {
+    // Zero is silence in every integer format
+    std::fill(scratch, scratch + periodSize * channels, 0.0f);
+    std::fill(deviceBuffer.begin(), deviceBuffer.end(), 0);
+    for (int i = 0; i < 2; i++) {
+        if (mmapAccess) {
+            mmapTransfer(scratch);
+        } else {
+            snd_pcm_writei(handle, deviceBuffer.data(), periodSize);
+        }
+    }
+}
+
+void AlsaOutput::enableDriftCompensation(unsigned int rate) {
+    sourceRate = rate;
+    resampler.reset(new DriftResampler(channels, periodSize, (double)rate / sampleRate));
+    drift.reset(new DriftEstimator(periodSize, sampleRate, rate));
+    resampleInput.assign(resampler->maxInputFrames() * channels, 0.0f);
+    
+    logger->log(LOG_INFO, "Drift compensation from " + std::to_string(rate) + " Hz to " +
+               std::to_string(sampleRate) + " Hz");
+}
+
+void AlsaOutput::playResampled(size_t inSamples) {
+    // Count what the producer gathered since its last burst too, otherwise
+    // the fill steps with the phase between the two clocks
+    uint64_t lastWrite = inputBuffer->lastWriteUs();
+    double pending = (double)(PipelineStats::nowUs() - lastWrite) * sourceRate * 1e-6;
+    double fill = (double)inputBuffer->availableRead() / channels + std::min(pending, 2.0 * periodSize);
+    double correction = drift->update(fill);
+    
+    inputBuffer->read(resampleInput.data(), inSamples);
+    resampler->process(resampleInput.data(), inSamples / channels, scratch, periodSize);
+    resampler->setCorrection(correction);
+    writePeriod(scratch);
+    
+    if (stats) stats->driftPpm.store((float)(correction * 1e6), std::memory_order_relaxed);
+}
+
+bool AlsaOutput::restartStream() {
+    if (!AlsaDevice::restartStream()) {
+        return false;
+    }
+    
+    prebuffer();
+    return true;
+}
+
+void AlsaOutput::outputLoop() {
+    const size_t periodSamples = periodSize * channels;
+    
+    logger->log(LOG_INFO, "Output thread started, writing " + std::to_string(periodSize) + " frames per period");
+    
+    applyThreadRtConfig(rtConfig, "Output", logger);
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    enterRtSection();
+    
+    prebuffer();
+    
+    while (running) {
+        if (state == STATE_RECOVERY || state == STATE_TERMINATING) {
+            waitForWake(100);
+            continue;
+        }
+        
+        // Restart only this PCM, then drop what queued up while it was down
+        // so the latency returns to what it was at start
+        if (state == STATE_ERROR) {
+            if (!restartStream()) {
+                waitForWake(RECOVERY_RETRY_MS);
                 continue;
             }
+            size_t dropped = inputBuffer->discardTo(RESYNC_PERIODS * periodSamples);
+            logger->logf(LOG_WARNING, "Output resynced, dropped %zu samples", dropped);
+            if (drift) drift->retarget();
         }
         
-        if (frames > 0 && frames < periodSize) {
-            logger->log(LOG_WARNING, "Short write: " + std::to_string(frames) + " frames of " + std::to_string(periodSize));
-        } else if (frames > 0) {
-            logger->log(LOG_INFO, "Wrote " + std::to_string(frames) + " frames to audio output");
+        // Wait for a full period of processed samples, resampling consumes
+        // a period at the source clock
+        size_t inSamples = resampler ? resampler->inputFrames(periodSize) * channels : periodSamples;
+        if (!inputBuffer->waitForRead(inSamples, 100)) {
+            if (inputBuffer->isClosed()) {
+                logger->logf(LOG_INFO, "Input buffer closed, exiting output loop");
+                break;
+            }
+            continue;
+        }
+        
+        uint64_t startUs = PipelineStats::nowUs();
+        
+        if (resampler) {
+            playResampled(inSamples);
+            if (stats) stats->recordStage(STAGE_OUTPUT, startUs);
+            continue;
         }
+        
+        // Play straight from ring memory when the period is contiguous
+        const float* data = nullptr;
+        if (inputBuffer->acquireRead(&data, periodSamples) == periodSamples) {
+            writePeriod(data);
+            inputBuffer->releaseRead(periodSamples);
+            if (stats) stats->recordStage(STAGE_OUTPUT, startUs);
+            continue;
+        }
+        
+        // Period wraps around the end of the ring, copy it out first; the
+        // wait above guarantees a full one
+        inputBuffer->read(scratch, periodSamples);
+        writePeriod(scratch);
+        if (stats) stats->recordStage(STAGE_OUTPUT, startUs);
     }
     
+    leaveRtSection();
     logger->log(LOG_INFO, "Output thread stopped");
 }
\ No newline at end of file
@@ -1,22 +1,47 @@
 #ifndef ALSA_OUTPUT_H
 #define ALSA_OUTPUT_H
 
+#include <memory>
 #include "alsa_common.h"
 #include "circular_buffer.h"
+#include "drift_resampler.h"
 
 class AlsaOutput : public AlsaDevice {
 private:
     CircularBuffer* inputBuffer;
     void outputLoop();
     
+    // Clock-drift compensation: periods are resampled from the ring so its
+    // fill, and with it the end-to-end latency, stays where it settled
+    std::unique_ptr<DriftResampler> resampler;
+    std::unique_ptr<DriftEstimator> drift;
+    std::vector<float> resampleInput;
+    unsigned int sourceRate;
+    void playResampled(size_t inSamples);
+    
 public:
     AlsaOutput(const std::string& dev, CircularBuffer* inBuf, 
-              ErrorHandler* errHandler, Logger* log);
+              ErrorHandler* errHandler, Logger* log, PipelineStats* st = nullptr);
     ~AlsaOutput();
     
     bool init() override;
     bool start() override;
     void stop() override;
+    
+    // Queue silence ahead of the first period to prevent initial underruns
+    void prebuffer();
+    
+    // Follow the clock of a source (the capture device) running at
+    // 'rate'. Threaded pipeline only; call after init(), before start().
+    void enableDriftCompensation(unsigned int rate);
+    
+    // Restarts playback behind freshly queued silence
+    bool restartStream() override;
+    
+    // Convert one period of float samples to the device format and write it,
+    // recovering from xruns/suspend. Returns frames written or a negative
+    // ALSA error.
+    snd_pcm_sframes_t writePeriod(const float* data);
 };
 
 #endif // ALSA_OUTPUT_H
\ No newline at end of file
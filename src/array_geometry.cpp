@@ -0,0 +1,205 @@
+#include "array_geometry.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+ArrayGeometry::ArrayGeometry() : deviceChannels(NUM_CHANNELS) {
+    mics.push_back({-MIC_DISTANCE / 2, 0.0f, 0.0f});
+    mics.push_back({MIC_DISTANCE / 2, 0.0f, 0.0f});
+    channelMap.push_back(0);
+    channelMap.push_back(1);
+}
+
+// Centre of the array and the unit vector from mic 0 to the mic farthest from it
+static void arrayFrame(const std::vector<MicPosition>& mics, MicPosition& centre, MicPosition& axis) {
+    centre = {0.0f, 0.0f, 0.0f};
+    for (const MicPosition& m : mics) {
+        centre.x += m.x / mics.size();
+        centre.y += m.y / mics.size();
+        centre.z += m.z / mics.size();
+    }
+    
+    float best = 0.0f;
+    axis = {1.0f, 0.0f, 0.0f};
+    for (const MicPosition& m : mics) {
+        float dx = m.x - mics[0].x;
+        float dy = m.y - mics[0].y;
+        float dz = m.z - mics[0].z;
+        float length = sqrtf(dx * dx + dy * dy + dz * dz);
+        if (length > best) {
+            best = length;
+            axis = {dx / length, dy / length, dz / length};
+        }
+    }
+}
+
+bool ArrayGeometry::isLinear() const {
+    MicPosition centre, axis;
+    arrayFrame(mics, centre, axis);
+    
+    // Distance of every mic from the axis line through mic 0, within 0.1 mm
+    for (const MicPosition& m : mics) {
+        float dx = m.x - mics[0].x;
+        float dy = m.y - mics[0].y;
+        float dz = m.z - mics[0].z;
+        float cx = dy * axis.z - dz * axis.y;
+        float cy = dz * axis.x - dx * axis.z;
+        float cz = dx * axis.y - dy * axis.x;
+        if (sqrtf(cx * cx + cy * cy + cz * cz) > 1e-4f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ArrayGeometry::isIdentityMap() const {
+    if (deviceChannels != micCount()) {
+        return false;
+    }
+    for (int m = 0; m < micCount(); m++) {
+        if (channelMap[m] != m) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ArrayGeometry::angleCount() const {
+    return isLinear() ? 181 : 360;
+}
+
+void ArrayGeometry::arrivalDelays(int angle, float* delays) const {
+    MicPosition centre, axis;
+    arrayFrame(mics, centre, axis);
+    bool linear = isLinear();
+    
+    // A mic further along the direction of the source hears it earlier
+    double angleRad = angle * M_PI / 180.0;
+    for (int m = 0; m < micCount(); m++) {
+        double dx = mics[m].x - centre.x;
+        double dy = mics[m].y - centre.y;
+        double dz = mics[m].z - centre.z;
+        double projection = linear ? (dx * axis.x + dy * axis.y + dz * axis.z) * cos(angleRad)
+                                   : dx * cos(angleRad) + dy * sin(angleRad);
+        delays[m] = (float)(-projection / SOUND_SPEED * SAMPLE_RATE);
+    }
+}
+
+float ArrayGeometry::maxArrivalDelay() const {
+    float delays[MAX_CHANNELS];
+    float worst = 0.0f;
+    for (int angle = 0; angle < angleCount(); angle++) {
+        arrivalDelays(angle, delays);
+        for (int m = 0; m < micCount(); m++) {
+            worst = std::max(worst, fabsf(delays[m]));
+        }
+    }
+    return worst;
+}
+
+std::string ArrayGeometry::describe() const {
+    std::ostringstream out;
+    out << micCount() << "-mic " << (isLinear() ? "linear" : "planar") << " array on "
+        << deviceChannels << " device channels, max arrival delay " << maxArrivalDelay() << " samples";
+    return out.str();
+}
+
+bool loadArrayGeometry(const std::string& path, ArrayGeometry& geometry, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Cannot open array geometry file: " + path;
+        return false;
+    }
+    
+    ArrayGeometry result;
+    result.mics.clear();
+    result.channelMap.clear();
+    result.deviceChannels = 0;
+    
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword)) {
+            continue;
+        }
+        
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (keyword == "mic") {
+            MicPosition m = {0.0f, 0.0f, 0.0f};
+            int channel = result.micCount();
+            if (!(in >> m.x >> m.y)) {
+                error = where + "expected mic X Y [Z [CHANNEL]]";
+                return false;
+            }
+            int given;
+            if (in >> m.z && in >> given) {
+                channel = given;
+            }
+            result.mics.push_back(m);
+            result.channelMap.push_back(channel);
+        } else if (keyword == "circular" || keyword == "linear") {
+            int count = 0;
+            float size = 0.0f;
+            if (!(in >> count >> size) || count < 1 || size <= 0.0f) {
+                error = where + "expected " + keyword + " N " + (keyword == "circular" ? "RADIUS" : "SPACING");
+                return false;
+            }
+            for (int i = 0; i < count; i++) {
+                MicPosition m = {0.0f, 0.0f, 0.0f};
+                if (keyword == "circular") {
+                    m.x = size * cosf(2.0f * M_PI * i / count);
+                    m.y = size * sinf(2.0f * M_PI * i / count);
+                } else {
+                    m.x = size * (i - (count - 1) / 2.0f);
+                }
+                result.channelMap.push_back(result.micCount());
+                result.mics.push_back(m);
+            }
+        } else if (keyword == "channels") {
+            if (!(in >> result.deviceChannels) || result.deviceChannels < 1 ||
+                result.deviceChannels > MAX_DEVICE_CHANNELS) {
+                error = where + "channels must be 1-" + std::to_string(MAX_DEVICE_CHANNELS);
+                return false;
+            }
+        } else {
+            error = where + "unknown keyword '" + keyword + "'";
+            return false;
+        }
+    }
+    
+    if (result.micCount() < 2 || result.micCount() > MAX_CHANNELS) {
+        error = path + ": array needs 2-" + std::to_string(MAX_CHANNELS) + " mics, got " +
+                std::to_string(result.micCount());
+        return false;
+    }
+    
+    // Without a channels line the device carries exactly the mapped channels
+    int highest = *std::max_element(result.channelMap.begin(), result.channelMap.end());
+    if (result.deviceChannels == 0) {
+        result.deviceChannels = highest + 1;
+    }
+    for (int m = 0; m < result.micCount(); m++) {
+        int channel = result.channelMap[m];
+        if (channel < 0 || channel >= result.deviceChannels ||
+            std::count(result.channelMap.begin(), result.channelMap.end(), channel) > 1) {
+            error = path + ": mic " + std::to_string(m) + " has an invalid or duplicate device channel " +
+                    std::to_string(channel);
+            return false;
+        }
+    }
+    
+    // The delay lines hold MAX_STEERING_DELAY samples of history
+    if (result.maxArrivalDelay() > MAX_STEERING_DELAY / 2) {
+        error = path + ": array aperture exceeds the " + std::to_string(MAX_STEERING_DELAY) +
+                " sample steering range";
+        return false;
+    }
+    
+    geometry = result;
+    return true;
+}
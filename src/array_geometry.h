@@ -0,0 +1,59 @@
+#ifndef ARRAY_GEOMETRY_H
+#define ARRAY_GEOMETRY_H
+
+#include <string>
+#include <vector>
+#include "beamformer_defs.h"
+
+// Microphone position in metres, any origin
+struct MicPosition {
+    float x;
+    float y;
+    float z;
+};
+
+// Microphone array layout and how its mics map onto the capture device
+struct ArrayGeometry {
+    std::vector<MicPosition> mics;
+    std::vector<int> channelMap;  // Device channel of each mic
+    int deviceChannels;           // Interleaved channels delivered by the device
+    
+    // Two mics MIC_DISTANCE apart on the x axis on device channels 0 and 1
+    ArrayGeometry();
+    
+    int micCount() const { return (int)mics.size(); }
+    
+    // All mics on one line: only 0-180 degrees can be told apart
+    bool isLinear() const;
+    
+    // Mic m is device channel m and the device has no extra channels
+    bool isIdentityMap() const;
+    
+    // Steering angles on the DOA grid, 181 (0-180) for linear arrays and
+    // 360 (0-359 azimuth) otherwise
+    int angleCount() const;
+    
+    // Far-field arrival time of a plane wave from 'angle' degrees at each
+    // mic, in samples relative to the array centre. Linear arrays measure
+    // the angle from the first-to-last mic axis, others use the azimuth in
+    // the x-y plane.
+    void arrivalDelays(int angle, float* delays) const;
+    
+    // Largest arrival delay magnitude over all angles, in samples
+    float maxArrivalDelay() const;
+    
+    std::string describe() const;
+};
+
+// Read an array description. Blank lines and '#' comments are ignored,
+// other lines are one of:
+//   mic X Y [Z [CHANNEL]]  position in metres, device channel defaults to
+//                          the mic's index
+//   circular N RADIUS      N mics evenly spaced on a circle, mic 0 on +x
+//   linear N SPACING       N mics along x centred on the origin
+//   channels N             interleaved channels of the capture device
+// Returns false with 'error' set when the file cannot be read or describes
+// an unusable array.
+bool loadArrayGeometry(const std::string& path, ArrayGeometry& geometry, std::string& error);
+
+#endif // ARRAY_GEOMETRY_H
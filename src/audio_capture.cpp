@@ -1,9 +1,11 @@
 #include "audio_capture.h"
+#include "simd_utils.h"
 #include <chrono>
+#include <cmath>
 
 AudioCapture::AudioCapture(const std::string& dev, CircularBuffer* outBuf, 
-                         ErrorHandler* errHandler, Logger* log) : 
-    AlsaDevice(dev, SAMPLE_RATE, NUM_CHANNELS, errHandler, log),
+                         ErrorHandler* errHandler, Logger* log, PipelineStats* st) : 
+    AlsaDevice(dev, SAMPLE_RATE, NUM_CHANNELS, errHandler, log, st),
     outputBuffer(outBuf) {
 }
 
@@ -52,6 +54,10 @@ bool AudioCapture::init() {
         return false;
     }
     
+    if (!setupPolling()) {
+        return false;
+    }
+    
     state = STATE_RUNNING;
     logger->log(LOG_INFO, "Audio capture initialized successfully");
     return true;
@@ -62,6 +68,7 @@ bool AudioCapture::start() {
         return true;
     }
     
+    prepareScratch();
     running = true;
     deviceThread = std::thread(&AudioCapture::captureLoop, this);
     
@@ -75,6 +82,7 @@ void AudioCapture::stop() {
     }
     
     running = false;
+    wake();
     
     if (deviceThread.joinable()) {
         deviceThread.join();
@@ -83,66 +91,129 @@ void AudioCapture::stop() {
     logger->log(LOG_INFO, "Audio capture stopped");
 }
 
+snd_pcm_sframes_t AudioCapture::readPeriod(float* data) {
+    // Convert straight out of the DMA buffer
+    if (mmapAccess) {
+        return mmapTransfer(data);
+    }
+    
+    const size_t frameBytes = channels * sampleFormatBytes(sampleFormat);
+    snd_pcm_uframes_t offset = 0;
+    
+    // A non-blocking PCM may deliver the period in several pieces
+    while (offset < periodSize && running) {
+        // Sleep until captured frames are available
+        if (!waitForDevice(100)) {
+            continue;
+        }
+        
+        snd_pcm_sframes_t frames = snd_pcm_readi(handle, deviceBuffer.data() + offset * frameBytes, periodSize - offset);
+        
+        if (frames == -EAGAIN) {
+            continue;  // Spurious wakeup in event mode
+        }
+        
+        if (frames < 0) {
+            logger->logf(LOG_WARNING, "ALSA read error: %s", snd_strerror(frames));
+            
+            int err = xrunRecovery(frames);
+            if (err < 0) {
+                state = STATE_ERROR;
+                return err;
+            }
+            
+            // Frames read before the overrun are not contiguous with what follows
+            offset = 0;
+            continue;
+        }
+        
+        if (frames == 0) {
+            logger->logf(LOG_WARNING, "ALSA read returned %ld frames", frames);
+            waitForWake(10);
+            continue;
+        }
+        
+        offset += frames;
+    }
+    
+    convertToFloat(sampleFormat, deviceBuffer.data(), data, offset * channels);
+    return offset;
+}
+
 void AudioCapture::captureLoop() {
-    int err;
-    std::vector<int16_t> buffer(periodSize * channels);
+    const size_t periodSamples = periodSize * channels;
     
     logger->log(LOG_INFO, "Capture thread started, reading " + std::to_string(periodSize) + " frames per period");
     
+    applyThreadRtConfig(rtConfig, "Capture", logger);
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    enterRtSection();
+    
     while (running) {
-        if (state == STATE_ERROR || state == STATE_RECOVERY || state == STATE_TERMINATING) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (state == STATE_RECOVERY || state == STATE_TERMINATING) {
+            waitForWake(100);
             continue;
         }
         
+        // Restart only this PCM, processing and output keep running on
+        // what is queued
+        if (state == STATE_ERROR && !restartStream()) {
+            waitForWake(RECOVERY_RETRY_MS);
+            continue;
+        }
+        
+        // Read straight into ring memory when a contiguous period is free,
+        // otherwise fall back to the scratch period and a copying write
+        float* dest = nullptr;
+        bool zeroCopy = outputBuffer->acquireWrite(&dest, periodSamples) == periodSamples;
+        if (!zeroCopy) {
+            dest = scratch;
+        }
+        
         // Read audio data
-        snd_pcm_sframes_t frames = snd_pcm_readi(handle, buffer.data(), periodSize);
+        snd_pcm_sframes_t frames = readPeriod(dest);
         
         if (frames < 0) {
-            logger->log(LOG_WARNING, "ALSA read error: " + std::string(snd_strerror(frames)));
-            
-            if (xrunRecovery(frames) < 0) {
-                errorHandler->reportError(ERROR_ALSA_XRUN, "Read error: " + std::string(snd_strerror(frames)));
-                state = STATE_ERROR;
-                continue;
-            }
+            errorHandler->reportError(ERROR_ALSA_XRUN, snd_strerror(frames));
             continue;
         }
         
         if (frames > 0) {
-            // Check if we have actual audio data
-            bool hasNonZeroSamples = false;
-            int16_t maxSample = 0;
-            for (int i = 0; i < std::min((int)(frames * channels), 100); i++) {
-                if (buffer[i] != 0) {
-                    hasNonZeroSamples = true;
-                    if (std::abs(buffer[i]) > std::abs(maxSample)) {
-                        maxSample = buffer[i];
-                    }
-                }
-            }
+            uint64_t startUs = PipelineStats::nowUs();
+            
+            // Check if we have actual audio data, the whole period in one vector pass
+            SignalLevel level = simdScanLevel(dest, frames * channels);
             
-            if (!hasNonZeroSamples) {
-                logger->log(LOG_WARNING, "All audio samples are zero");
+            if (level.peak == 0.0f) {
+                logger->logf(LOG_WARNING, "All audio samples are zero");
+                if (stats) PipelineStats::increment(stats->zeroFrames);
             } else {
-                logger->log(LOG_INFO, "Captured " + std::to_string(frames) + " frames, max amplitude: " + std::to_string(maxSample));
+                logger->logf(LOG_INFO, "Captured %ld frames, peak %.4f, rms %.4f", frames, (double)level.peak,
+                             (double)level.rms);
                 
-                // Write captured data to output buffer
+                // Publish captured data to the output buffer
                 size_t samplesToWrite = frames * channels;
-                size_t written = outputBuffer->write(buffer.data(), samplesToWrite);
+                size_t written;
+                if (zeroCopy) {
+                    outputBuffer->commitWrite(samplesToWrite);
+                    written = samplesToWrite;
+                } else {
+                    written = outputBuffer->write(scratch, samplesToWrite);
+                }
                 
                 if (written < samplesToWrite) {
-                    logger->log(LOG_WARNING, "Buffer overflow, dropped " + 
-                             std::to_string(samplesToWrite - written) + " samples");
+                    logger->logf(LOG_WARNING, "Buffer overflow, dropped %zu samples", samplesToWrite - written);
+                    if (stats) PipelineStats::increment(stats->ringOverflows);
                 } else {
-                    logger->log(LOG_INFO, "Wrote " + std::to_string(written) + " samples to output buffer");
+                    logger->logf(LOG_INFO, "Wrote %zu samples to output buffer", written);
                 }
             }
-        } else {
-            logger->log(LOG_WARNING, "ALSA read returned " + std::to_string(frames) + " frames");
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            
+            if (stats) stats->recordStage(STAGE_CAPTURE, startUs);
         }
     }
     
+    leaveRtSection();
     logger->log(LOG_INFO, "Capture thread stopped");
 }
\ No newline at end of file
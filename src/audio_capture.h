@@ -11,12 +11,17 @@ private:
     
 public:
     AudioCapture(const std::string& dev, CircularBuffer* outBuf, 
-                ErrorHandler* errHandler, Logger* log);
+                ErrorHandler* errHandler, Logger* log, PipelineStats* st = nullptr);
     ~AudioCapture();
     
     bool init() override;
     bool start() override;
     void stop() override;
+    
+    // Read one full period of interleaved frames as float, recovering from
+    // overruns. Returns frames read (short only when stopping) or a negative
+    // ALSA error.
+    snd_pcm_sframes_t readPeriod(float* data);
 };
 
 #endif // AUDIO_CAPTURE_H
\ No newline at end of file
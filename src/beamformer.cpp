@@ -1,94 +1,231 @@
 #include "beamformer.h"
+#include "simd_utils.h"
+#include "config_file.h"
 #include <cmath>
 #include <chrono>
 #include <algorithm>
 #include <cstring>
 #include <thread>
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 // Global variables
 BeamFormerApp* BeamFormerApp::instance = nullptr;
+std::atomic<bool> BeamFormerApp::statsRequested(false);
 std::atomic<bool> sig_received(false);
 
 // BeamFormer DspResources implementation
 BeamFormer::DspResources::DspResources() {
-    for (int c = 0; c < NUM_CHANNELS; c++) {
-        fftPlanFwd[c] = nullptr;
+    for (int c = 0; c < MAX_CHANNELS; c++) {
         fftIn[c] = nullptr;
         fftOut[c] = nullptr;
-        delayLinePos[c] = 0;
+        osBlock[c] = nullptr;
+        osSpectrum[c] = nullptr;
+    }
+    for (int p = 0; p < MAX_MIC_PAIRS; p++) {
+        crossSpectrum[p] = nullptr;
     }
+    fftPlanFwd = nullptr;
     fftPlanBwd = nullptr;
     fftProcessed = nullptr;
+    fftResult = nullptr;
+    for (int t = 0; t < MAX_COVARIANCE_TERMS; t++) {
+        covariance[t] = nullptr;
+    }
+    mvdrWeights = nullptr;
 }
 
 BeamFormer::DspResources::~DspResources() {
-    for (int c = 0; c < NUM_CHANNELS; c++) {
+    for (int c = 0; c < MAX_CHANNELS; c++) {
         if (fftIn[c]) fftwf_free(fftIn[c]);
         if (fftOut[c]) fftwf_free(fftOut[c]);
-        if (fftPlanFwd[c]) fftwf_destroy_plan(fftPlanFwd[c]);
+        if (osBlock[c]) fftwf_free(osBlock[c]);
+        if (osSpectrum[c]) fftwf_free(osSpectrum[c]);
+    }
+    for (int p = 0; p < MAX_MIC_PAIRS; p++) {
+        if (crossSpectrum[p]) fftwf_free(crossSpectrum[p]);
     }
     
     if (fftProcessed) fftwf_free(fftProcessed);
-    if (fftPlanBwd) fftwf_destroy_plan(fftPlanBwd);
+    if (fftResult) fftwf_free(fftResult);
+    for (int t = 0; t < MAX_COVARIANCE_TERMS; t++) {
+        if (covariance[t]) fftwf_free(covariance[t]);
+    }
+    if (mvdrWeights) fftwf_free(mvdrWeights);
 }
 
-bool BeamFormer::DspResources::init() {
-    // Initialize FFT
-    for (int c = 0; c < NUM_CHANNELS; c++) {
-        fftIn[c] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
-        fftOut[c] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
+bool BeamFormer::DspResources::init(DspCache* cache, unsigned planFlags, int frameSize, int fftSize, int channels,
+                                    int pairs, int beams) {
+    const int fftBins = fftSize / 2 + 1;
+    
+    // The cache plans on buffers of its own, these are never scribbled over
+    fftPlanFwd = cache->forwardPlan(fftSize, planFlags);
+    fftPlanBwd = cache->backwardPlan(fftSize, planFlags);
+    if (!fftPlanFwd || !fftPlanBwd) {
+        return false;
+    }
+    
+    for (int c = 0; c < channels; c++) {
+        fftIn[c] = (float*)fftwf_malloc(sizeof(float) * fftSize);
+        fftOut[c] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
         
         if (!fftIn[c] || !fftOut[c]) {
             return false;
         }
         
-        fftPlanFwd[c] = fftwf_plan_dft_1d(FFT_SIZE, fftIn[c], fftOut[c], FFTW_FORWARD, FFTW_ESTIMATE);
-        if (!fftPlanFwd[c]) {
+        // Only the first frameSize samples are ever written, the rest is zero padding
+        memset(fftIn[c], 0, sizeof(float) * fftSize);
+        
+        // Overlap-save blocks are transformed with the same plan
+        osBlock[c] = (float*)fftwf_malloc(sizeof(float) * fftSize);
+        osSpectrum[c] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
+        if (!osBlock[c] || !osSpectrum[c]) {
             return false;
         }
+        memset(osBlock[c], 0, sizeof(float) * fftSize);
         
         // Initialize delay lines
-        delayLine[c].resize(MAX_STEERING_DELAY * 2);
-        delayLinePos[c] = 0;
+        delayLine[c].assign(DELAY_LINE_HISTORY + frameSize, 0.0f);
+        q15Line[c].assign(DELAY_LINE_HISTORY + frameSize, 0);
+        q15DoaLine[c].assign(Q15_DOA_HISTORY + frameSize, 0);
+        q15Energy[c] = 0.0f;
     }
     
-    fftProcessed = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
-    if (!fftProcessed) {
+    fftProcessed = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
+    fftResult = (float*)fftwf_malloc(sizeof(float) * fftSize);
+    if (!fftProcessed || !fftResult) {
         return false;
     }
     
-    fftPlanBwd = fftwf_plan_dft_1d(FFT_SIZE, fftProcessed, fftProcessed, FFTW_BACKWARD, FFTW_ESTIMATE);
-    if (!fftPlanBwd) {
+    for (int p = 0; p < pairs; p++) {
+        crossSpectrum[p] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
+        if (!crossSpectrum[p]) {
+            return false;
+        }
+        memset(crossSpectrum[p], 0, sizeof(fftwf_complex) * fftBins);
+        q15Correlation[p].assign(2 * MAX_STEERING_DELAY + 1, 0.0f);
+        pairCorrelation[p].assign(2 * MAX_STEERING_DELAY + 1, 0.0f);
+    }
+    
+    for (int t = 0; t < channels * (channels + 1) / 2; t++) {
+        covariance[t] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
+        if (!covariance[t]) {
+            return false;
+        }
+        memset(covariance[t], 0, sizeof(fftwf_complex) * fftBins);
+    }
+    mvdrWeights = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (MAX_BEAMS + 1) * channels * fftBins);
+    if (!mvdrWeights) {
         return false;
     }
+    prefaultBuffer(mvdrWeights, sizeof(fftwf_complex) * (MAX_BEAMS + 1) * channels * fftBins);
+    
+    // Crossfade ramp rising from 0 to 1 across one frame
+    fadeRamp.resize(frameSize);
+    fadeBuffer.assign(frameSize, 0.0f);
+    passthroughBuffer.assign(frameSize * beams, 0.0f);
+    for (int b = 0; b < beams && beams > 1; b++) {
+        beamBuffer[b].assign(frameSize, 0.0f);
+    }
+    for (int i = 0; i < frameSize; i++) {
+        fadeRamp[i] = 0.5f - 0.5f * cosf(M_PI * (i + 0.5f) / frameSize);
+    }
+    
+    // Hann window for the DOA analysis frames
+    doaWindow.resize(frameSize);
+    for (int i = 0; i < frameSize; i++) {
+        doaWindow[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * i / (frameSize - 1));
+    }
+    
+    // FFT outputs are first written on the processing thread, fault them in now
+    for (int c = 0; c < channels; c++) {
+        prefaultBuffer(fftOut[c], sizeof(fftwf_complex) * fftBins);
+        prefaultBuffer(osSpectrum[c], sizeof(fftwf_complex) * fftBins);
+    }
+    prefaultBuffer(fftProcessed, sizeof(fftwf_complex) * fftBins);
+    prefaultBuffer(fftResult, sizeof(float) * fftSize);
     
     return true;
 }
 
 // BeamFormer implementation
 BeamFormer::BeamFormer(CircularBuffer* inBuf, CircularBuffer* outBuf, 
-                     ErrorHandler* errHandler, Logger* log) : 
+                     ErrorHandler* errHandler, Logger* log,
+                     const BeamFormerConfig& cfg, PipelineStats* st) : 
     inputBuffer(inBuf),
     outputBuffer(outBuf),
     running(false),
     state(STATE_INIT),
     currentSteeringAngle(90),  // Start with broadside (90 degrees)
+    targetSteeringAngle(90),
+    config(cfg),
+    frameCount(0),
+    doaAngle(-1),
+    fixedAngle(-1),
+    frameSize(cfg.frameSize),
+    fftSize(1),
+    numChannels(cfg.geometry.micCount()),
+    inputChannels(cfg.geometry.deviceChannels),
+    angleCount(cfg.geometry.angleCount()),
+    pairCount(numChannels * (numChannels - 1) / 2),
+    beamCount(cfg.beamCount()),
     dspResources(new DspResources()),
+    dspCache(nullptr),
+    inScratch(nullptr),
+    outScratch(nullptr),
+    frameEnergy(0.0f),
+    noiseFloor(0.0f),
+    vadRatio(1.0f),
+    vadMinEnergy(0.0f),
+    floorRise(1.0f),
+    vadHangoverFrames(1),
+    vadHangover(0),
+    idleFrames(0),
+    quietFrames(0),
+    voiceActive(true),
+    passthrough(false),
+    mvdrFrameCount(0),
     useNeon(false),
     errorHandler(errHandler),
-    logger(log) {
-    
-    // Check for ARM NEON support
-    #ifdef __ARM_NEON
-    useNeon = true;
-    logger->log(LOG_INFO, "ARM NEON instructions available");
-    #else
-    useNeon = false;
-    logger->log(LOG_INFO, "ARM NEON instructions not available");
-    #endif
-    
-    // Initialize delay angle calculations
-    calculateDelaysForAngles();
+    logger(log),
+    stats(st) {
+    
+    // Check for ARM NEON support, built in and reported by the CPU
+    useNeon = simdEnabled();
+    logger->log(LOG_INFO, useNeon ? "ARM NEON instructions available" :
+                          simdAvailable() ? "ARM NEON disabled, using scalar kernels" :
+                                            "ARM NEON instructions not available");
+    
+    while (fftSize < 2 * frameSize) {
+        fftSize <<= 1;
+    }
+    fftBins = fftSize / 2 + 1;
+    
+    std::fill(doaScores, doaScores + MAX_DOA_ANGLES, 0.0f);
+    std::fill(mvdrAngle, mvdrAngle + MAX_BEAMS + 1, -1);
+    
+    for (int c = 0; c < std::min(numChannels, MAX_CHANNELS); c++) {
+        channelMap[c] = cfg.geometry.channelMap[c];
+    }
+    beamAngles[0] = -1;  // Tracked
+    for (int b = 1; b < std::min(beamCount, MAX_BEAMS); b++) {
+        beamAngles[b] = cfg.beamAngles[b - 1];
+    }
+    
+    // Fixed-count kernels also need mic c on input channel c with nothing
+    // interleaved in between, other layouts gather through channelMap
+    switch (numChannels) {
+        case 2: kernels = kernelsFor<2>(useNeon); break;
+        case 4: kernels = kernelsFor<4>(useNeon); break;
+        case 6: kernels = kernelsFor<6>(useNeon); break;
+        case 8: kernels = kernelsFor<8>(useNeon); break;
+        default: kernels = kernelsFor<0>(useNeon); break;
+    }
+    if (!cfg.geometry.isIdentityMap()) {
+        kernels.deinterleave = kernelsFor<0>(useNeon).deinterleave;
+    }
 }
 
 BeamFormer::~BeamFormer() {
@@ -98,11 +235,122 @@ BeamFormer::~BeamFormer() {
 bool BeamFormer::init() {
     logger->log(LOG_INFO, "Initializing beamformer");
     
-    if (!dspResources->init()) {
+    if (numChannels < 2 || numChannels > MAX_CHANNELS || inputChannels > MAX_DEVICE_CHANNELS) {
+        logger->log(LOG_ERR, "Unsupported array of " + std::to_string(numChannels) + " mics on " +
+                   std::to_string(inputChannels) + " channels");
+        return false;
+    }
+    if (config.geometry.maxArrivalDelay() > MAX_STEERING_DELAY / 2) {
+        logger->log(LOG_ERR, "Array aperture exceeds the steering range of " +
+                   std::to_string(MAX_STEERING_DELAY) + " samples");
+        return false;
+    }
+    
+    if (beamCount > MAX_BEAMS) {
+        logger->log(LOG_ERR, "At most " + std::to_string(MAX_BEAMS) + " beams are supported");
+        return false;
+    }
+    for (int b = 1; b < beamCount; b++) {
+        if (beamAngles[b] < 0 || beamAngles[b] >= angleCount) {
+            logger->log(LOG_ERR, "Beam angle " + std::to_string(beamAngles[b]) + " is outside the 0-" +
+                       std::to_string(angleCount - 1) + " degree grid of this array");
+            return false;
+        }
+    }
+    
+    bool fixedKernels = numChannels <= MAX_CHANNELS && numChannels % 2 == 0;
+    logger->log(LOG_INFO, "Array: " + config.geometry.describe() + ", " +
+               (fixedKernels ? std::to_string(numChannels) + "-channel" : std::string("generic")) + " kernels");
+    
+    if (beamCount > 1) {
+        std::string angles;
+        for (int b = 1; b < beamCount; b++) {
+            angles += " " + std::to_string(beamAngles[b]);
+        }
+        logger->log(LOG_INFO, std::to_string(beamCount) + " output beams: tracked, then fixed at" + angles + " degrees");
+    }
+    
+    if (config.engine == ENGINE_MVDR) {
+        logger->log(LOG_INFO, "MVDR weights solved every " + std::to_string(config.mvdrInterval) +
+                   " frames, covariance smoothing " + std::to_string(config.mvdrSmoothing) +
+                   ", loading " + std::to_string(config.mvdrLoading));
+    }
+    
+    // VAD thresholds as energy ratios and frame counts
+    const float frameSeconds = (float)frameSize / SAMPLE_RATE;
+    vadRatio = powf(10.0f, config.vadThresholdDb / 10.0f);
+    vadMinEnergy = powf(10.0f, VAD_MIN_LEVEL_DB / 10.0f);
+    floorRise = powf(10.0f, VAD_FLOOR_RISE_DB * frameSeconds / 10.0f);
+    vadHangoverFrames = std::max(1, (int)(VAD_HANGOVER_MS / 1000.0f / frameSeconds));
+    idleFrames = config.vadEnabled && config.vadIdleSeconds > 0 ?
+                 (int)(config.vadIdleSeconds / frameSeconds) : 0;
+    if (config.vadEnabled) {
+        logger->log(LOG_INFO, "Voice activity gates DOA at " + std::to_string(config.vadThresholdDb) +
+                   " dB over the noise floor" + (idleFrames > 0 ? ", passthrough after " +
+                   std::to_string(config.vadIdleSeconds) + " s of silence" : std::string()));
+    }
+    
+    calculateDelaysForAngles();
+    
+    // Reuse previously tuned plans so MEASURE/PATIENT only cost time once
+    unsigned planFlags = FFTW_ESTIMATE;
+    if (config.fftPlanMode == FFT_PLAN_MEASURE) {
+        planFlags = FFTW_MEASURE;
+    } else if (config.fftPlanMode == FFT_PLAN_PATIENT) {
+        planFlags = FFTW_PATIENT;
+    }
+    
+    bool haveWisdom = false;
+    if (planFlags != FFTW_ESTIMATE && !config.fftWisdomFile.empty()) {
+        haveWisdom = fftwf_import_wisdom_from_filename(config.fftWisdomFile.c_str()) != 0;
+        logger->log(LOG_INFO, haveWisdom ? "Loaded FFTW wisdom from " + config.fftWisdomFile
+                                         : "No FFTW wisdom at " + config.fftWisdomFile + ", planning from scratch");
+    }
+    
+    auto planStart = std::chrono::steady_clock::now();
+    
+    if (!dspCache) {
+        ownDspCache.reset(new DspCache());
+        dspCache = ownDspCache.get();
+    }
+    
+    if (!dspResources->init(dspCache, planFlags, frameSize, fftSize, numChannels, pairCount, beamCount)) {
         logger->log(LOG_ERR, "Failed to initialize DSP resources");
         return false;
     }
     
+    // Arrays of the same layout steer alike, the first one builds the tables
+    dspResources->steering = dspCache->findSteering(config.geometry, fftSize);
+    if (dspResources->steering) {
+        logger->log(LOG_INFO, "Sharing steering tables with another array of the same layout");
+    } else {
+        std::shared_ptr<SteeringTables> tables = std::make_shared<SteeringTables>();
+        tables->delayTaps.resize(angleCount * numChannels);
+        tables->weights = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * angleCount * numChannels * fftBins);
+        if (!tables->weights) {
+            logger->log(LOG_ERR, "Failed to allocate steering tables");
+            return false;
+        }
+        calculateSteeringWeights(*tables);
+        dspCache->addSteering(config.geometry, fftSize, tables);
+        dspResources->steering = tables;
+    }
+    
+    auto planMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - planStart).count();
+    logger->log(LOG_INFO, "FFT plans ready in " + std::to_string(planMs) + " ms");
+    
+    // Save newly measured plans for the next start. Loaded wisdom may not
+    // cover a new frame size, a slow planning pass means it was extended.
+    if (planFlags != FFTW_ESTIMATE && (!haveWisdom || planMs >= FFT_WISDOM_SAVE_MS) &&
+        !config.fftWisdomFile.empty()) {
+        if (fftwf_export_wisdom_to_filename(config.fftWisdomFile.c_str())) {
+            logger->log(LOG_INFO, "Saved FFTW wisdom to " + config.fftWisdomFile);
+        } else {
+            logger->log(LOG_WARNING, "Cannot save FFTW wisdom to " + config.fftWisdomFile);
+        }
+    }
+    
     state = STATE_RUNNING;
     logger->log(LOG_INFO, "Beamformer initialized successfully");
     return true;
@@ -113,6 +361,13 @@ bool BeamFormer::start() {
         return true;
     }
     
+    if (!inScratch || !outScratch) {
+        size_t inSamples = (size_t)frameSize * inputChannels;
+        ownScratch.assign(inSamples + (size_t)frameSize * beamCount, 0.0f);
+        inScratch = ownScratch.data();
+        outScratch = ownScratch.data() + inSamples;
+    }
+    
     running = true;
     processingThread = std::thread(&BeamFormer::processingLoop, this);
     
@@ -135,237 +390,1724 @@ void BeamFormer::stop() {
 }
 
 void BeamFormer::calculateDelaysForAngles() {
-    // Pre-calculate delay values for all possible steering angles
-    for (int angle = 0; angle <= 180; angle++) {
-        // Convert angle to radians (0 degrees = left, 90 degrees = center, 180 degrees = right)
-        float angleRad = (angle - 90) * M_PI / 180.0f;
+    // Far-field arrival time at every mic for each angle on the grid. The
+    // exact values steer, pairwise differences rounded to whole samples are
+    // the lags SRP-PHAT scores.
+    std::fill(pairLagSpan, pairLagSpan + MAX_MIC_PAIRS, 0);
+    for (int angle = 0; angle < angleCount; angle++) {
+        config.geometry.arrivalDelays(angle, arrivalDelay[angle]);
+        
+        int p = 0;
+        for (int i = 0; i < numChannels; i++) {
+            for (int j = i + 1; j < numChannels; j++, p++) {
+                pairLag[angle][p] = (int)round(arrivalDelay[angle][j] - arrivalDelay[angle][i]);
+                pairLagSpan[p] = std::max(pairLagSpan[p], std::abs(pairLag[angle][p]) + 1);
+            }
+        }
+    }
+    
+    // The span leaves one lag either side of every peak for the refinement
+    for (int p = 0; p < pairCount; p++) {
+        pairLagSpan[p] = std::min(pairLagSpan[p], MAX_STEERING_DELAY);
+    }
+    
+    // A small array has only a few whole-sample lags per pair, most angles
+    // share their set with neighbours
+    lagSetCount = 0;
+    for (int angle = 0; angle < angleCount; angle++) {
+        int set = 0;
+        while (set < lagSetCount &&
+               memcmp(pairLag[lagSetAngle[set]], pairLag[angle], pairCount * sizeof(int)) != 0) {
+            set++;
+        }
+        if (set == lagSetCount) {
+            lagSetAngle[lagSetCount++] = angle;
+        }
+        angleLagSet[angle] = set;
+    }
+}
+
+void BeamFormer::channelDelays(int angle, float* delays) const {
+    // Delay each mic by how early it hears the source, offset so every delay
+    // stays positive and at least one sample, keeping the interpolator causal
+    for (int c = 0; c < numChannels; c++) {
+        delays[c] = MAX_STEERING_DELAY / 2 + 1 - arrivalDelay[angle][c];
+    }
+}
+
+// Third-order Lagrange coefficients evaluated Farrow-style at the
+// fractional delay, stored oldest tap first and pre-scaled for the sum
+static inline void lagrangeWeights(float f, float scale, float* w) {
+    w[0] = scale * (f + 1.0f) * f * (f - 1.0f) / 6.0f;
+    w[1] = scale * -(f + 1.0f) * f * (f - 2.0f) / 2.0f;
+    w[2] = scale * (f + 1.0f) * (f - 1.0f) * (f - 2.0f) / 2.0f;
+    w[3] = scale * -f * (f - 1.0f) * (f - 2.0f) / 6.0f;
+}
+
+void BeamFormer::calculateSteeringWeights(SteeringTables& tables) {
+    // A delay of d samples is a phase ramp exp(-j*2*pi*k*d/N). The channel
+    // average and the 1/N of the unnormalised inverse FFT are folded in too.
+    const float scale = 1.0f / (numChannels * fftSize);
+    
+    for (int angle = 0; angle < angleCount; angle++) {
+        float delays[MAX_CHANNELS];
+        channelDelays(angle, delays);
+        
+        // Time domain: the whole part selects the taps, the fraction sets
+        // the interpolator. The Q15 weights are each below 1 / channels so
+        // none saturates.
+        for (int c = 0; c < numChannels; c++) {
+            DelayTaps& taps = tables.delayTaps[angle * numChannels + c];
+            taps.whole = (int)floorf(delays[c]);
+            lagrangeWeights(delays[c] - taps.whole, 1.0f / numChannels, taps.weights);
+            simdFloatToS16(taps.weights, taps.weightsQ15, FRACTIONAL_DELAY_TAPS);
+        }
+        
+        for (int c = 0; c < numChannels; c++) {
+            fftwf_complex* w = tables.weights + (angle * numChannels + c) * fftBins;
+            for (int k = 0; k < fftBins; k++) {
+                double phase = -2.0 * M_PI * k * delays[c] / fftSize;
+                w[k][0] = scale * cos(phase);
+                w[k][1] = scale * sin(phase);
+            }
+        }
+    }
+}
+
+bool BeamFormer::processFrame(const float* input, float* output) {
+    try {
+        applyControlCommands();
+        
+        // Both engines and the DOA analysis read the de-interleaved delay
+        // lines, the same pass measures the frame energy for the VAD
+        bool wasPassthrough = passthrough;
+        updateVoiceActivity(loadDelayLines(input));
+        
+        // Accumulate the cross-spectra over voice frames only, so noise
+        // cannot pull the steering around, and decide DOA every few frames.
+        // A fixed steering override keeps the estimate for queries.
+        if (voiceActive) {
+            if (config.engine == ENGINE_FIXED_POINT) {
+                updateCorrelationQ15();
+            } else {
+                updateCrossSpectrum();
+            }
+        }
+        if (++frameCount >= config.doaInterval) {
+            frameCount = 0;
+            if (voiceActive) {
+                doaAngle = estimateDOA();
+                if (fixedAngle < 0 && doaAngle >= 0 && doaAngle < angleCount) {
+                    updateSteering(doaAngle);
+                }
+            }
+            publishStatus();
+        }
         
-        // Calculate time delay between microphones based on angle
-        // Using formula: delay = (d * sin(?)) / c
-        // where d = distance between mics, ? = angle, c = speed of sound
-        float delaySeconds = (MIC_DISTANCE * sin(angleRad)) / SOUND_SPEED;
+        if (passthrough && wasPassthrough) {
+            renderPassthrough(output);
+            return true;
+        }
         
-        // Convert to samples
-        float delaySamples = delaySeconds * SAMPLE_RATE;
+        // Include current TDOA angle in logging
+        logger->logf(LOG_INFO, "Processing frame with steering angle: %d degrees",
+                     currentSteeringAngle.load());
         
-        // Store the integer delay value
-        delayPerAngle[angle] = (int)round(delaySamples);
+        // Steer and sum the current frame
+        if (config.engine == ENGINE_TIME_DOMAIN) {
+            processFrameTimeDomain(output);
+        } else if (config.engine == ENGINE_FIXED_POINT) {
+            renderSteered(&BeamFormer::steerFixedPoint, output);
+        } else {
+            processFrameFrequencyDomain(output);
+        }
         
-        // Ensure within valid range
-        if (delayPerAngle[angle] > MAX_STEERING_DELAY)
-            delayPerAngle[angle] = MAX_STEERING_DELAY;
-        if (delayPerAngle[angle] < -MAX_STEERING_DELAY)
-            delayPerAngle[angle] = -MAX_STEERING_DELAY;
+        // Crossfade over one frame when idle mode starts or ends
+        if (passthrough != wasPassthrough) {
+            float* bypass = dspResources->passthroughBuffer.data();
+            renderPassthrough(bypass);
+            const float* ramp = dspResources->fadeRamp.data();
+            for (int i = 0; i < frameSize; i++) {
+                float toBypass = passthrough ? ramp[i] : 1.0f - ramp[i];
+                for (int b = 0; b < beamCount; b++) {
+                    float& sample = output[i * beamCount + b];
+                    sample += toBypass * (bypass[i * beamCount + b] - sample);
+                }
+            }
+        }
+    } catch (const std::exception&) {
+        // what() is not static, so it cannot go through the RT record queue
+        logger->logf(LOG_ERR, "Processing error in processFrame");
+        errorHandler->reportError(ERROR_PROCESSING, "Exception in processFrame");
+        state = STATE_ERROR;
+        return false;
     }
+    
+    return true;
+}
+
+void BeamFormer::restartProcessing() {
+    DspResources* dsp = dspResources.get();
+    for (int c = 0; c < numChannels; c++) {
+        std::fill(dsp->delayLine[c].begin(), dsp->delayLine[c].end(), 0.0f);
+        memset(dsp->osBlock[c], 0, sizeof(float) * fftSize);
+    }
+    for (int p = 0; p < pairCount; p++) {
+        memset(dsp->crossSpectrum[p], 0, sizeof(fftwf_complex) * fftBins);
+    }
+    resetMvdr();
+    resetFixedPoint();
+    
+    // Resume on the target angle without a fade, with the VAD relearning the floor
+    currentSteeringAngle.store(targetSteeringAngle.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    frameCount = 0;
+    noiseFloor = 0.0f;
+    vadHangover = 0;
+    quietFrames = 0;
+    voiceActive = true;
+    passthrough = false;
+    
+    if (stats) PipelineStats::increment(stats->recoveries);
+    state = STATE_RUNNING;
 }
 
 void BeamFormer::processingLoop() {
     logger->log(LOG_INFO, "Processing thread started");
     
-    std::vector<int16_t> inBuffer(FRAME_SIZE * NUM_CHANNELS);
-    std::vector<int16_t> outBuffer(FRAME_SIZE);
+    applyThreadRtConfig(config.processRt, "Processing", logger);
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    enterRtSection();
     
     while (running) {
-        if (state == STATE_ERROR || state == STATE_RECOVERY || state == STATE_TERMINATING) {
+        if (state == STATE_RECOVERY || state == STATE_TERMINATING) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
         
-        // Read input samples
-        size_t read = inputBuffer->read(inBuffer.data(), FRAME_SIZE * NUM_CHANNELS);
+        // A failed frame restarts processing on this thread without touching
+        // capture, continuing from the newest input
+        if (state == STATE_ERROR) {
+            restartProcessing();
+            size_t dropped = inputBuffer->discardTo(RESYNC_PERIODS * (size_t)frameSize * inputChannels);
+            logger->logf(LOG_WARNING, "Processing restarted, dropped %zu samples", dropped);
+        }
         
-        if (read < FRAME_SIZE * NUM_CHANNELS) {
+        // Wait for a complete frame before consuming anything from the ring
+        if (!inputBuffer->waitForRead(frameSize * inputChannels, 100)) {
             if (inputBuffer->isClosed()) {
                 break;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
         
-        try {
-            // Estimate DOA every few frames
-            static int frameCount = 0;
-            if (frameCount++ % 10 == 0) {
-                int angle = estimateDOA(inBuffer.data());
-                if (angle >= 0 && angle <= 180) {
-                    updateSteering(angle);
-                }
-            }
-            
-            // Include current TDOA angle in logging
-            if (logger->isLoggingEnabled()) {
-                logger->log(LOG_INFO, "Processing frame with steering angle: " + 
-                           std::to_string(currentSteeringAngle) + " degrees");
-            }
-            
-            // Process the current frame - simple passthrough for now
-            for (int i = 0; i < FRAME_SIZE; i++) {
-                // Basic mixing of channels
-                outBuffer[i] = (inBuffer[i * NUM_CHANNELS] + inBuffer[i * NUM_CHANNELS + 1]) / 2;
-            }
-            
-            // Write output samples
-            size_t written = outputBuffer->write(outBuffer.data(), FRAME_SIZE);
-            
-            if (written < FRAME_SIZE) {
-                logger->log(LOG_WARNING, "Output buffer overflow");
-            }
-        } catch (const std::exception& e) {
-            logger->log(LOG_ERR, "Processing error: " + std::string(e.what()));
-            errorHandler->reportError(ERROR_PROCESSING, e.what());
-            state = STATE_ERROR;
+        // A file sink is slower than real time at times; hold the input
+        // rather than lose output
+        if (config.outputBackpressure &&
+            !outputBuffer->waitForWrite((size_t)frameSize * beamCount, 100)) {
+            continue;
         }
+        
+        processQueuedFrame();
+    }
+    
+    // Pass end of stream from a finite source on to the consumer
+    if (inputBuffer->isClosed()) {
+        outputBuffer->close();
     }
     
+    leaveRtSection();
     logger->log(LOG_INFO, "Processing thread stopped");
 }
 
-void BeamFormer::processFrameTimeDomain(const int16_t* input, int16_t* output) {
-    // Simple implementation - will be replaced with actual beamforming
-    for (int i = 0; i < FRAME_SIZE; i++) {
-        output[i] = (input[i * NUM_CHANNELS] + input[i * NUM_CHANNELS + 1]) / 2;
+bool BeamFormer::processPending() {
+    if (state == STATE_TERMINATING) {
+        return false;
+    }
+    if (state == STATE_RECOVERY) {
+        return true;
+    }
+    
+    if (state == STATE_ERROR) {
+        restartProcessing();
+        size_t dropped = inputBuffer->discardTo(RESYNC_PERIODS * (size_t)frameSize * inputChannels);
+        logger->logf(LOG_WARNING, "Processing restarted, dropped %zu samples", dropped);
+    }
+    
+    if (inputBuffer->availableRead() < (size_t)frameSize * inputChannels) {
+        if (inputBuffer->isClosed()) {
+            outputBuffer->close();
+            return false;
+        }
+        return true;
     }
+    
+    processQueuedFrame();
+    return true;
 }
 
-void BeamFormer::processFrameFrequencyDomain(const int16_t* input, int16_t* output) {
-    // Simplified implementation
-    processFrameTimeDomain(input, output);
+void BeamFormer::processQueuedFrame() {
+    const size_t outSamples = (size_t)frameSize * beamCount;
+    uint64_t startUs = PipelineStats::nowUs();
+        
+    // Process in place from ring memory when the frame is contiguous
+    const size_t frameSamples = frameSize * inputChannels;
+    const float* in = nullptr;
+    bool zeroCopyIn = inputBuffer->acquireRead(&in, frameSamples) == frameSamples;
+    if (!zeroCopyIn) {
+        inputBuffer->read(inScratch, frameSamples);
+        in = inScratch;
+    }
+    
+    // Likewise write the result straight into the output ring when possible
+    float* out = nullptr;
+    bool zeroCopyOut = outputBuffer->acquireWrite(&out, outSamples) == outSamples;
+    if (!zeroCopyOut) {
+        out = outScratch;
+    }
+    
+    if (processFrame(in, out)) {
+        // Write output samples
+        size_t written = outSamples;
+        if (zeroCopyOut) {
+            outputBuffer->commitWrite(outSamples);
+        } else {
+            written = outputBuffer->write(outScratch, outSamples);
+        }
+        
+        if (written < outSamples) {
+            logger->logf(LOG_WARNING, "Output buffer overflow");
+            if (stats) PipelineStats::increment(stats->ringOverflows);
+        }
+    }
+    
+    // Hand the consumed input frame back to the capture side
+    if (zeroCopyIn) {
+        inputBuffer->releaseRead(frameSamples);
+    }
+    
+    if (stats) stats->recordStage(STAGE_PROCESS, startUs);
 }
 
-int BeamFormer::estimateDOA(const int16_t* input) {
-    // Placeholder - return center angle
-    return 90;
+float BeamFormer::loadDelayLines(const float* input) {
+    float* lines[MAX_CHANNELS];
+    for (int c = 0; c < numChannels; c++) {
+        float* line = dspResources->delayLine[c].data();
+        
+        // Carry the tail of the previous frame over as history
+        memmove(line, line + frameSize, DELAY_LINE_HISTORY * sizeof(float));
+        lines[c] = line + DELAY_LINE_HISTORY;
+    }
+    
+    float energy = kernels.deinterleave(input, channelMap, inputChannels, lines, frameSize, numChannels);
+    
+    // Overlap-save blocks slide in either engine, so switching to the
+    // frequency domain at run time starts from current history
+    const int overlap = fftSize - frameSize;
+    for (int c = 0; c < numChannels; c++) {
+        memmove(dspResources->osBlock[c], dspResources->osBlock[c] + frameSize, overlap * sizeof(float));
+        memcpy(dspResources->osBlock[c] + overlap, lines[c], frameSize * sizeof(float));
+    }
+    
+    if (config.engine == ENGINE_FIXED_POINT) {
+        loadFixedPointLines(lines);
+    }
+    
+    return energy / (frameSize * numChannels);
 }
 
-void BeamFormer::updateSteering(int angle) {
-    // Update current steering angle
-    currentSteeringAngle = angle;
-    
-    // Include angle in log
-    logger->log(LOG_INFO, "Steering angle updated to " + std::to_string(angle) + " degrees");
+void BeamFormer::loadFixedPointLines(const float* const* lines) {
+    DspResources* dsp = dspResources.get();
+    for (int c = 0; c < numChannels; c++) {
+        int16_t* line = dsp->q15Line[c].data();
+        memmove(line, line + frameSize, DELAY_LINE_HISTORY * sizeof(int16_t));
+        simdFloatToS16(lines[c], line + DELAY_LINE_HISTORY, frameSize);
+        
+        // Differencing whitens the spectrum a little, as PHAT does for the
+        // float DOA, so low frequencies do not flatten the correlation peak
+        int16_t* doa = dsp->q15DoaLine[c].data();
+        memmove(doa, doa + frameSize, Q15_DOA_HISTORY * sizeof(int16_t));
+        kernels.whitenQ15(line + DELAY_LINE_HISTORY, doa + Q15_DOA_HISTORY, frameSize);
+    }
 }
 
-void BeamFormer::applyWeightsNeon(const int16_t* input, int16_t* output, int length) {
-    // Simple implementation - will be replaced with NEON optimization
-    for (int i = 0; i < length; i++) {
-        output[i] = (input[i * NUM_CHANNELS] + input[i * NUM_CHANNELS + 1]) / 2;
+void BeamFormer::resetFixedPoint() {
+    // Rebuild the Q15 lines from the float ones, the differenced history
+    // before what the delay lines hold stays zero
+    DspResources* dsp = dspResources.get();
+    const int length = DELAY_LINE_HISTORY + frameSize;
+    const int offset = Q15_DOA_HISTORY - DELAY_LINE_HISTORY;
+    for (int c = 0; c < numChannels; c++) {
+        int16_t* line = dsp->q15Line[c].data();
+        int16_t* doa = dsp->q15DoaLine[c].data();
+        simdFloatToS16(dsp->delayLine[c].data(), line, length);
+        std::fill(dsp->q15DoaLine[c].begin(), dsp->q15DoaLine[c].end(), 0);
+        kernels.whitenQ15(line + 1, doa + offset + 1, length - 1);
+        dsp->q15Energy[c] = 0.0f;
+    }
+    for (int p = 0; p < pairCount; p++) {
+        std::fill(dsp->q15Correlation[p].begin(), dsp->q15Correlation[p].end(), 0.0f);
     }
 }
 
-// BeamFormerApp implementation
-BeamFormerApp::BeamFormerApp(const std::string& inDevice, const std::string& outDevice, bool enableLogging) : 
-    inputDevice(inDevice),
-    outputDevice(outDevice),
-    loggingEnabled(enableLogging),
-    running(false) {
+void BeamFormer::updateVoiceActivity(float energy) {
+    frameEnergy = energy;
     
-    // Store instance for signal handler
-    instance = this;
+    // Follow quieter frames down at once and creep up slowly, so the floor
+    // tracks the background but not a talker
+    if (noiseFloor <= 0.0f || energy < noiseFloor) {
+        noiseFloor = std::max(energy, 1e-12f);
+    } else {
+        noiseFloor *= floorRise;
+    }
+    
+    if (energy > noiseFloor * vadRatio && energy > vadMinEnergy) {
+        vadHangover = vadHangoverFrames;
+    } else if (vadHangover > 0) {
+        vadHangover--;
+    }
+    
+    bool voice = !config.vadEnabled || vadHangover > 0;
+    quietFrames = voice ? 0 : quietFrames + 1;
+    bool idle = idleFrames > 0 && quietFrames >= idleFrames;
+    
+    if (voice != voiceActive || idle != passthrough) {
+        if (idle && !passthrough) {
+            logger->logf(LOG_INFO, "Quiet for %d s, entering low-power passthrough", config.vadIdleSeconds);
+        } else if (!idle && passthrough) {
+            logger->logf(LOG_INFO, "Voice detected, leaving passthrough");
+        }
+        voiceActive = voice;
+        passthrough = idle;
+        publishStatus();
+    }
 }
 
-BeamFormerApp::~BeamFormerApp() {
-    stop();
-    instance = nullptr;
+void BeamFormer::renderPassthrough(float* output) {
+    // Unsteered mean of the mics, delayed like a steered beam so the
+    // crossfades in and out of idle line up
+    const int offset = DELAY_LINE_HISTORY - (MAX_STEERING_DELAY / 2 + 1);
+    const float gain = 1.0f / numChannels;
+    for (int i = 0; i < frameSize; i++) {
+        float sum = 0.0f;
+        for (int c = 0; c < numChannels; c++) {
+            sum += dspResources->delayLine[c][offset + i];
+        }
+        for (int b = 0; b < beamCount; b++) {
+            output[i * beamCount + b] = sum * gain;
+        }
+    }
 }
 
-bool BeamFormerApp::init() {
-    // Create logger first with specified logging state
-    logger = std::make_unique<Logger>(true, loggingEnabled);
+void BeamFormer::renderSteered(void (BeamFormer::*steer)(const int*, float* const*, int), float* output) {
+    DspResources* dsp = dspResources.get();
+    int target = targetSteeringAngle.load(std::memory_order_relaxed);
+    int current = currentSteeringAngle.load(std::memory_order_relaxed);
+    bool fading = target != current;
     
-    if (!logger) {
-        fprintf(stderr, "Failed to create logger\n");
-        return false;
+    // A single beam renders straight into the output frame
+    int angles[MAX_BEAMS + 1];
+    float* outputs[MAX_BEAMS + 1];
+    angles[0] = target;
+    outputs[0] = beamCount == 1 ? output : dsp->beamBuffer[0].data();
+    for (int b = 1; b < beamCount; b++) {
+        angles[b] = beamAngles[b];
+        outputs[b] = dsp->beamBuffer[b].data();
     }
     
-    logger->log(LOG_INFO, "Initializing BeamFormer application");
+    // While the tracked beam moves, its old steering is rendered in the
+    // same pass as one more beam and crossfaded, so a jump in delay never
+    // produces a discontinuity in the output
+    int beams = beamCount;
+    if (fading) {
+        angles[beams] = current;
+        outputs[beams] = dsp->fadeBuffer.data();
+        beams++;
+    }
     
-    // Create error handler
-    errorHandler = std::make_unique<ErrorHandler>(logger.get());
+    (this->*steer)(angles, outputs, beams);
     
-    if (!errorHandler) {
-        logger->log(LOG_ERR, "Failed to create error handler");
-        return false;
+    if (fading) {
+        float* tracked = outputs[0];
+        const float* previous = dsp->fadeBuffer.data();
+        const float* ramp = dsp->fadeRamp.data();
+        for (int i = 0; i < frameSize; i++) {
+            tracked[i] = previous[i] + ramp[i] * (tracked[i] - previous[i]);
+        }
+        
+        currentSteeringAngle.store(target, std::memory_order_relaxed);
+        
+        SteeringEvent event;
+        event.previousAngle = current;
+        event.newAngle = target;
+        steeringEvents.push(event);  // Dropped if the reader falls behind
     }
     
-    // Create circular buffers
-    captureToBeamformer = std::make_unique<CircularBuffer>(BUFFER_SIZE);
-    beamformerToOutput = std::make_unique<CircularBuffer>(BUFFER_SIZE);
+    if (beamCount > 1) {
+        simdInterleave(outputs, output, beamCount, frameSize);
+    }
+}
+
+void BeamFormer::steerBeams(const int* angles, float* const* outputs, int beams) {
+    if (config.engine == ENGINE_TIME_DOMAIN) {
+        steerTimeDomain(angles, outputs, beams);
+    } else if (config.engine == ENGINE_FIXED_POINT) {
+        steerFixedPoint(angles, outputs, beams);
+    } else {
+        steerFrequencyDomain(angles, outputs, beams);
+    }
+}
+
+void BeamFormer::processFrameTimeDomain(float* output) {
+    renderSteered(&BeamFormer::steerTimeDomain, output);
+}
+
+void BeamFormer::steerTimeDomain(const int* angles, float* const* outputs, int beams) {
+    const float* taps[(MAX_BEAMS + 1) * MAX_CHANNELS];
+    float weights[(MAX_BEAMS + 1) * MAX_CHANNELS][FRACTIONAL_DELAY_TAPS];
     
-    if (!captureToBeamformer || !beamformerToOutput) {
-        logger->log(LOG_ERR, "Failed to create circular buffers");
-        return false;
+    for (int b = 0; b < beams; b++) {
+        const DelayTaps* delays = &dspResources->steering->delayTaps[angles[b] * numChannels];
+        for (int c = 0; c < numChannels; c++) {
+            memcpy(weights[b * numChannels + c], delays[c].weights, sizeof(weights[0]));
+            
+            // Output n uses samples n - whole - 2 ... n - whole + 1
+            taps[b * numChannels + c] = dspResources->delayLine[c].data() + DELAY_LINE_HISTORY - delays[c].whole - 2;
+        }
     }
     
-    // Create components
-    audioCapture = std::make_unique<AudioCapture>(inputDevice, captureToBeamformer.get(), errorHandler.get(), logger.get());
-    beamformer = std::make_unique<BeamFormer>(captureToBeamformer.get(), beamformerToOutput.get(), errorHandler.get(), logger.get());
-    alsaOutput = std::make_unique<AlsaOutput>(outputDevice, beamformerToOutput.get(), errorHandler.get(), logger.get());
+    kernels.delaySum(taps, weights, outputs, beams, frameSize, numChannels);
+}
+
+void BeamFormer::steerFixedPoint(const int* angles, float* const* outputs, int beams) {
+    const int16_t* taps[(MAX_BEAMS + 1) * MAX_CHANNELS];
+    int16_t weights[(MAX_BEAMS + 1) * MAX_CHANNELS][FRACTIONAL_DELAY_TAPS];
     
-    if (!audioCapture || !beamformer || !alsaOutput) {
-        logger->log(LOG_ERR, "Failed to create components");
-        return false;
+    for (int b = 0; b < beams; b++) {
+        const DelayTaps* delays = &dspResources->steering->delayTaps[angles[b] * numChannels];
+        for (int c = 0; c < numChannels; c++) {
+            memcpy(weights[b * numChannels + c], delays[c].weightsQ15, sizeof(weights[0]));
+            taps[b * numChannels + c] = dspResources->q15Line[c].data() + DELAY_LINE_HISTORY - delays[c].whole - 2;
+        }
     }
     
-    // Initialize components
-    if (!audioCapture->init()) {
-        logger->log(LOG_ERR, "Failed to initialize audio capture");
-        return false;
-    }
+    kernels.delaySumQ15(taps, weights, outputs, beams, frameSize, numChannels);
+}
+
+void BeamFormer::processFrameFrequencyDomain(float* output) {
+    DspResources* dsp = dspResources.get();
     
-    if (!beamformer->init()) {
-        logger->log(LOG_ERR, "Failed to initialize beamformer");
-        return false;
+    // Overlap-save: transform each block, already slid by one hop in
+    // loadDelayLines(). The delay lines stay current too, so the engines
+    // can be switched seamlessly.
+    for (int c = 0; c < numChannels; c++) {
+        fftwf_execute_dft_r2c(dsp->fftPlanFwd, dsp->osBlock[c], dsp->osSpectrum[c]);
     }
     
-    if (!alsaOutput->init()) {
-        logger->log(LOG_ERR, "Failed to initialize ALSA output");
-        return false;
+    if (config.engine == ENGINE_MVDR) {
+        kernels.covariance(dsp->osSpectrum, dsp->covariance, fftBins, config.mvdrSmoothing, numChannels);
+        updateMvdrWeights();
     }
     
-    // Set up signal handler
-    struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = sigHandler;
-    sigaction(SIGINT, &sa, NULL);
-    sigaction(SIGTERM, &sa, NULL);
-    
-    logger->log(LOG_INFO, "BeamFormer application initialized successfully");
-    return true;
+    renderSteered(&BeamFormer::steerFrequencyDomain, output);
 }
 
-bool BeamFormerApp::start() {
-    if (running) {
-        return true;
+void BeamFormer::updateMvdrWeights() {
+    DspResources* dsp = dspResources.get();
+    
+    // The angles renderSteered() asks for this frame: tracked target, fixed
+    // beams and, while fading, the previous tracked angle
+    int angles[MAX_BEAMS + 1];
+    int count = 0;
+    angles[count++] = targetSteeringAngle.load(std::memory_order_relaxed);
+    for (int b = 1; b < beamCount; b++) {
+        angles[count++] = beamAngles[b];
+    }
+    int current = currentSteeringAngle.load(std::memory_order_relaxed);
+    if (current != angles[0]) {
+        angles[count++] = current;
     }
     
-    logger->log(LOG_INFO, "Starting BeamFormer application");
+    // Solve on schedule, or at once when a new angle has no weights yet
+    bool missing = false;
+    for (int b = 0; b < count; b++) {
+        missing = missing || std::find(mvdrAngle, mvdrAngle + MAX_BEAMS + 1, angles[b]) == mvdrAngle + MAX_BEAMS + 1;
+    }
+    if (++mvdrFrameCount < config.mvdrInterval && !missing) {
+        return;
+    }
+    mvdrFrameCount = 0;
     
-    // Start components in reverse order to ensure buffers are ready
-    if (!alsaOutput->start()) {
-        logger->log(LOG_ERR, "Failed to start ALSA output");
-        return false;
+    const fftwf_complex* steering[MAX_BEAMS + 1];
+    fftwf_complex* weights[MAX_BEAMS + 1];
+    for (int b = 0; b <= MAX_BEAMS; b++) {
+        mvdrAngle[b] = b < count ? angles[b] : -1;
+    }
+    for (int b = 0; b < count; b++) {
+        steering[b] = dsp->steering->weights + angles[b] * numChannels * fftBins;
+        weights[b] = dsp->mvdrWeights + b * numChannels * fftBins;
     }
     
-    if (!beamformer->start()) {
-        logger->log(LOG_ERR, "Failed to start beamformer");
+    // Unit gain towards the steering angle with the 1/N of the inverse FFT folded in
+    const float scale = 1.0f / ((float)fftSize * fftSize * numChannels);
+    kernels.mvdrSolve(dsp->covariance, steering, weights, count, fftBins, config.mvdrLoading, scale, numChannels);
+}
+
+void BeamFormer::resetMvdr() {
+    DspResources* dsp = dspResources.get();
+    for (int t = 0; t < numChannels * (numChannels + 1) / 2; t++) {
+        memset(dsp->covariance[t], 0, sizeof(fftwf_complex) * fftBins);
+    }
+    std::fill(mvdrAngle, mvdrAngle + MAX_BEAMS + 1, -1);
+    mvdrFrameCount = 0;
+}
+
+const fftwf_complex* BeamFormer::frequencyWeights(int angle) const {
+    if (config.engine == ENGINE_MVDR) {
+        for (int slot = 0; slot <= MAX_BEAMS; slot++) {
+            if (mvdrAngle[slot] == angle) {
+                return dspResources->mvdrWeights + slot * numChannels * fftBins;
+            }
+        }
+    }
+    return dspResources->steering->weights + angle * numChannels * fftBins;
+}
+
+void BeamFormer::steerFrequencyDomain(const int* angles, float* const* outputs, int beams) {
+    DspResources* dsp = dspResources.get();
+    const int overlap = fftSize - frameSize;
+    
+    // Every beam reuses the channel spectra, only the weighted sum across
+    // channels with the cached phase ramps and the inverse FFT are per beam
+    for (int b = 0; b < beams; b++) {
+        const fftwf_complex* weights = frequencyWeights(angles[b]);
+        kernels.steerSum(weights, dsp->osSpectrum, dsp->fftProcessed, fftBins, numChannels);
+        
+        fftwf_execute_dft_c2r(dsp->fftPlanBwd, dsp->fftProcessed, dsp->fftResult);
+        
+        // The last frameSize samples are free of circular wrap-around
+        memcpy(outputs[b], dsp->fftResult + overlap, frameSize * sizeof(float));
+    }
+}
+
+void BeamFormer::updateCrossSpectrum() {
+    DspResources* dsp = dspResources.get();
+    
+    // Windowed frames, zero padded to fftSize so the correlation is linear
+    for (int c = 0; c < numChannels; c++) {
+        const float* line = dsp->delayLine[c].data() + DELAY_LINE_HISTORY;
+        for (int i = 0; i < frameSize; i++) {
+            dsp->fftIn[c][i] = line[i] * dsp->doaWindow[i];
+        }
+        fftwf_execute_dft_r2c(dsp->fftPlanFwd, dsp->fftIn[c], dsp->fftOut[c]);
+    }
+    
+    // Exponentially smoothed Xj * conj(Xi) for every pair i < j
+    kernels.crossSpectra(dsp->fftOut, dsp->crossSpectrum, fftBins, config.doaSmoothing, numChannels);
+}
+
+void BeamFormer::updateCorrelationQ15() {
+    DspResources* dsp = dspResources.get();
+    const float alpha = config.doaSmoothing;
+    
+    const int16_t* lines[MAX_CHANNELS];
+    for (int c = 0; c < numChannels; c++) {
+        lines[c] = dsp->q15DoaLine[c].data() + Q15_DOA_HISTORY;
+        float energy = (float)kernels.dotQ15(lines[c], lines[c], frameSize);
+        dsp->q15Energy[c] = alpha * dsp->q15Energy[c] + (1.0f - alpha) * energy;
+    }
+    
+    // Sum of xj[n] * xi[n - lag] over one frame, the window shifted back by
+    // the lag span of the pair so both ends stay within the history
+    int p = 0;
+    for (int i = 0; i < numChannels; i++) {
+        for (int j = i + 1; j < numChannels; j++, p++) {
+            const int span = pairLagSpan[p];
+            float* r = dsp->q15Correlation[p].data() + MAX_STEERING_DELAY;
+            for (int lag = -span; lag <= span; lag++) {
+                float value = (float)kernels.dotQ15(lines[j] - span, lines[i] - span - lag, frameSize);
+                r[lag] = alpha * r[lag] + (1.0f - alpha) * value;
+            }
+        }
+    }
+}
+
+void BeamFormer::correlatePhat() {
+    DspResources* dsp = dspResources.get();
+    
+    // GCC-PHAT correlation of every mic pair
+    for (int p = 0; p < pairCount; p++) {
+        // PHAT weighting keeps only the phase of the smoothed cross-spectrum
+        const fftwf_complex* cross = dsp->crossSpectrum[p];
+        for (int k = 0; k < fftBins; k++) {
+            float re = cross[k][0];
+            float im = cross[k][1];
+            float mag = sqrtf(re * re + im * im);
+            if (mag < 1e-20f) {
+                dsp->fftProcessed[k][0] = 0.0f;
+                dsp->fftProcessed[k][1] = 0.0f;
+            } else {
+                dsp->fftProcessed[k][0] = re / mag;
+                dsp->fftProcessed[k][1] = im / mag;
+            }
+        }
+        
+        // Back to the lag domain: the peak sits at the lag of mic j behind mic i
+        fftwf_execute_dft_c2r(dsp->fftPlanBwd, dsp->fftProcessed, dsp->fftResult);
+        
+        float* r = dsp->pairCorrelation[p].data() + MAX_STEERING_DELAY;
+        for (int lag = -pairLagSpan[p]; lag <= pairLagSpan[p]; lag++) {
+            r[lag] = dsp->fftResult[lag < 0 ? lag + fftSize : lag];
+        }
+    }
+}
+
+void BeamFormer::correlateFixedPoint() {
+    DspResources* dsp = dspResources.get();
+    
+    // Normalised correlation of the differenced pairs
+    int p = 0;
+    for (int i = 0; i < numChannels; i++) {
+        for (int j = i + 1; j < numChannels; j++, p++) {
+            float energy = dsp->q15Energy[i] * dsp->q15Energy[j];
+            const float norm = energy > 0.0f ? 1.0f / sqrtf(energy) : 0.0f;
+            const float* in = dsp->q15Correlation[p].data() + MAX_STEERING_DELAY;
+            float* r = dsp->pairCorrelation[p].data() + MAX_STEERING_DELAY;
+            for (int lag = -pairLagSpan[p]; lag <= pairLagSpan[p]; lag++) {
+                r[lag] = in[lag] * norm;
+            }
+        }
+    }
+}
+
+int BeamFormer::estimateDOA() {
+    DspResources* dsp = dspResources.get();
+    
+    if (config.engine == ENGINE_FIXED_POINT) {
+        correlateFixedPoint();
+    } else {
+        correlatePhat();
+    }
+    
+    // SRP: the correlations summed at the lags each angle predicts, once per
+    // distinct set of lags
+    int bestSet = 0;
+    for (int set = 0; set < lagSetCount; set++) {
+        const int* lags = pairLag[lagSetAngle[set]];
+        float score = 0.0f;
+        for (int p = 0; p < pairCount; p++) {
+            score += dsp->pairCorrelation[p][MAX_STEERING_DELAY + lags[p]];
+        }
+        lagSetScore[set] = score;
+        if (score > lagSetScore[bestSet]) {
+            bestSet = set;
+        }
+    }
+    
+    for (int angle = 0; angle < angleCount; angle++) {
+        doaScores[angle] = lagSetScore[angleLagSet[angle]];
+    }
+    
+    // A parabola through each pair's peak and its neighbours gives the lag to
+    // a fraction of a sample
+    const int* lags = pairLag[lagSetAngle[bestSet]];
+    float refined[MAX_MIC_PAIRS];
+    for (int p = 0; p < pairCount; p++) {
+        refined[p] = (float)lags[p];
+        if (std::abs(lags[p]) >= pairLagSpan[p]) {
+            continue;
+        }
+        const float* r = dsp->pairCorrelation[p].data() + MAX_STEERING_DELAY + lags[p];
+        float curvature = r[-1] - 2.0f * r[0] + r[1];
+        if (curvature < 0.0f) {
+            float offset = 0.5f * (r[-1] - r[1]) / curvature;
+            refined[p] += std::max(-0.5f, std::min(0.5f, offset));
+        }
+    }
+    
+    // Of the angles sharing the winning lags, the one whose exact delays
+    // best match the refined lags
+    int best = lagSetAngle[bestSet];
+    float bestError = INFINITY;
+    for (int angle = 0; angle < angleCount; angle++) {
+        if (angleLagSet[angle] != bestSet) {
+            continue;
+        }
+        float error = 0.0f;
+        int p = 0;
+        for (int i = 0; i < numChannels; i++) {
+            for (int j = i + 1; j < numChannels; j++, p++) {
+                float miss = arrivalDelay[angle][j] - arrivalDelay[angle][i] - refined[p];
+                error += miss * miss;
+            }
+        }
+        if (error < bestError) {
+            bestError = error;
+            best = angle;
+        }
+    }
+    
+    return best;
+}
+
+void BeamFormer::updateSteering(int angle) {
+    // Only record the target here; the next frame crossfades to it and
+    // queues the change for logging outside the processing thread
+    targetSteeringAngle.store(angle, std::memory_order_relaxed);
+}
+
+void BeamFormer::applyControlCommands() {
+    ControlCommand command;
+    bool changed = false;
+    while (controlCommands.pop(command)) {
+        changed = true;
+        if (command.type == CONTROL_STEER) {
+            fixedAngle = command.value;
+            if (fixedAngle >= 0) {
+                updateSteering(fixedAngle);
+                logger->logf(LOG_INFO, "Steering fixed at %d degrees", fixedAngle);
+            } else {
+                logger->logf(LOG_INFO, "Steering follows DOA");
+            }
+        } else if (command.type == CONTROL_ENGINE) {
+            // A fresh covariance, stale statistics would steer nulls at old sources
+            BeamformerEngine engine = (BeamformerEngine)command.value;
+            if (engine == ENGINE_MVDR && config.engine != ENGINE_MVDR) {
+                resetMvdr();
+            }
+            // Each DOA keeps its statistics only while its engine runs
+            if (engine == ENGINE_FIXED_POINT && config.engine != ENGINE_FIXED_POINT) {
+                resetFixedPoint();
+            } else if (engine != ENGINE_FIXED_POINT && config.engine == ENGINE_FIXED_POINT) {
+                for (int p = 0; p < pairCount; p++) {
+                    memset(dspResources->crossSpectrum[p], 0, sizeof(fftwf_complex) * fftBins);
+                }
+            }
+            config.engine = engine;
+            logger->logf(LOG_INFO, "Switched to %s engine", engineName(engine));
+        }
+    }
+    
+    if (changed) {
+        publishStatus();
+    }
+}
+
+void BeamFormer::publishStatus() {
+    BeamFormerStatus& status = statusMailbox.writeSlot();
+    status.doaAngle = doaAngle;
+    status.fixedAngle = fixedAngle;
+    status.engine = config.engine;
+    status.angleCount = angleCount;
+    status.voiceActive = voiceActive;
+    status.passthrough = passthrough;
+    status.levelDb = 10.0f * log10f(frameEnergy + 1e-12f);
+    status.noiseFloorDb = 10.0f * log10f(noiseFloor + 1e-12f);
+    memcpy(status.doaScores, doaScores, angleCount * sizeof(float));
+    statusMailbox.publish();
+}
+
+bool BeamFormer::requestSteering(int angle) {
+    if (angle < -1 || angle >= angleCount) {
         return false;
     }
     
-    if (!audioCapture->start()) {
-        logger->log(LOG_ERR, "Failed to start audio capture");
+    ControlCommand command;
+    command.type = CONTROL_STEER;
+    command.value = angle;
+    return controlCommands.push(command);
+}
+
+bool BeamFormer::requestEngine(BeamformerEngine engine) {
+    ControlCommand command;
+    command.type = CONTROL_ENGINE;
+    command.value = engine;
+    return controlCommands.push(command);
+}
+
+bool BeamFormer::readStatus(BeamFormerStatus& status) {
+    return statusMailbox.read(status);
+}
+
+void BeamFormer::drainEvents() {
+    SteeringEvent event;
+    while (steeringEvents.pop(event)) {
+        logger->log(LOG_INFO, "Steering angle updated from " + std::to_string(event.previousAngle) +
+                   " to " + std::to_string(event.newAngle) + " degrees");
+    }
+}
+
+// Channel-count specialised kernels. Channels is the compile-time mic
+// count, 0 selects the generic versions that take it at run time.
+#ifdef __ARM_NEON
+static inline float32x4_t mulAdd(float32x4_t acc, float32x4_t a, float32x4_t b) {
+#if defined(__aarch64__)
+    return vfmaq_f32(acc, a, b);
+#else
+    return vmlaq_f32(acc, a, b);
+#endif
+}
+
+static inline float32x4_t mulSub(float32x4_t acc, float32x4_t a, float32x4_t b) {
+#if defined(__aarch64__)
+    return vfmsq_f32(acc, a, b);
+#else
+    return vmlsq_f32(acc, a, b);
+#endif
+}
+#endif
+
+template <int Channels>
+static float deinterleave(const float* input, const int* map, int stride, float* const* lines,
+                          int length, int channels) {
+    if (Channels > 0) {
+        return simdDeinterleave(input, lines, Channels, length);
+    }
+    
+    // Any layout: gather each mic from its device channel
+    float energy = 0.0f;
+    for (int i = 0; i < length; i++) {
+        for (int c = 0; c < channels; c++) {
+            float sample = input[i * stride + map[c]];
+            lines[c][i] = sample;
+            energy += sample * sample;
+        }
+    }
+    return energy;
+}
+
+// Beams are interleaved per block of output samples, so the delay line
+// span a block reads is fetched once and stays in L1 for every beam
+#define DELAY_SUM_BLOCK 64
+
+template <int Channels>
+static void delaySumScalar(const float* const* taps, const float (*weights)[FRACTIONAL_DELAY_TAPS],
+                           float* const* outputs, int beams, int length, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    for (int start = 0; start < length; start += DELAY_SUM_BLOCK) {
+        const int end = std::min(length, start + DELAY_SUM_BLOCK);
+        for (int b = 0; b < beams; b++) {
+            const float* const* t = taps + b * count;
+            const float (*w)[FRACTIONAL_DELAY_TAPS] = weights + b * count;
+            for (int i = start; i < end; i++) {
+                float acc = 0.0f;
+                for (int c = 0; c < count; c++) {
+                    for (int k = 0; k < FRACTIONAL_DELAY_TAPS; k++) {
+                        acc += w[c][k] * t[c][i + k];
+                    }
+                }
+                outputs[b][i] = acc;
+            }
+        }
+    }
+}
+
+template <int Channels>
+static void delaySumNeon(const float* const* taps, const float (*weights)[FRACTIONAL_DELAY_TAPS],
+                         float* const* outputs, int beams, int length, int channels) {
+#ifdef __ARM_NEON
+    const int count = Channels > 0 ? Channels : channels;
+    int i = 0;
+    
+    // 8 output samples of every beam per iteration, two float32x4
+    // accumulators per beam
+    for (; i + 8 <= length; i += 8) {
+        for (int b = 0; b < beams; b++) {
+            const float* const* t = taps + b * count;
+            const float (*w)[FRACTIONAL_DELAY_TAPS] = weights + b * count;
+            float32x4_t accLo = vdupq_n_f32(0.0f);
+            float32x4_t accHi = vdupq_n_f32(0.0f);
+            
+            for (int c = 0; c < count; c++) {
+                const float* x = t[c] + i;
+                for (int k = 0; k < FRACTIONAL_DELAY_TAPS; k++) {
+                    float32x4_t wk = vdupq_n_f32(w[c][k]);
+                    accLo = mulAdd(accLo, vld1q_f32(x + k), wk);
+                    accHi = mulAdd(accHi, vld1q_f32(x + k + 4), wk);
+                }
+            }
+            
+            vst1q_f32(outputs[b] + i, accLo);
+            vst1q_f32(outputs[b] + i + 4, accHi);
+        }
+    }
+    
+    // Remaining samples
+    if (i < length) {
+        const float* tail[(MAX_BEAMS + 1) * MAX_CHANNELS];
+        float* tailOut[MAX_BEAMS + 1];
+        for (int b = 0; b < beams; b++) {
+            for (int c = 0; c < count; c++) {
+                tail[b * count + c] = taps[b * count + c] + i;
+            }
+            tailOut[b] = outputs[b] + i;
+        }
+        delaySumScalar<Channels>(tail, weights, tailOut, beams, length - i, channels);
+    }
+#else
+    delaySumScalar<Channels>(taps, weights, outputs, beams, length, channels);
+#endif
+}
+
+// Q15 samples times Q15 weights, doubled into a saturating Q31 sum as
+// vqdmlal does, so the scalar and NEON paths agree bit for bit
+static inline int32_t macQ31(int32_t acc, int16_t x, int16_t w) {
+    int64_t product = std::min((int64_t)2 * x * w, (int64_t)INT32_MAX);
+    return (int32_t)std::max((int64_t)INT32_MIN, std::min((int64_t)INT32_MAX, acc + product));
+}
+
+static const float Q31_SCALE = 1.0f / 2147483648.0f;
+
+template <int Channels>
+static void delaySumQ15Scalar(const int16_t* const* taps, const int16_t (*weights)[FRACTIONAL_DELAY_TAPS],
+                              float* const* outputs, int beams, int length, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    for (int start = 0; start < length; start += DELAY_SUM_BLOCK) {
+        const int end = std::min(length, start + DELAY_SUM_BLOCK);
+        for (int b = 0; b < beams; b++) {
+            const int16_t* const* t = taps + b * count;
+            const int16_t (*w)[FRACTIONAL_DELAY_TAPS] = weights + b * count;
+            for (int i = start; i < end; i++) {
+                int32_t acc = 0;
+                for (int c = 0; c < count; c++) {
+                    for (int k = 0; k < FRACTIONAL_DELAY_TAPS; k++) {
+                        acc = macQ31(acc, t[c][i + k], w[c][k]);
+                    }
+                }
+                outputs[b][i] = (float)acc * Q31_SCALE;
+            }
+        }
+    }
+}
+
+template <int Channels>
+static void delaySumQ15Neon(const int16_t* const* taps, const int16_t (*weights)[FRACTIONAL_DELAY_TAPS],
+                            float* const* outputs, int beams, int length, int channels) {
+#ifdef __ARM_NEON
+    const int count = Channels > 0 ? Channels : channels;
+    int i = 0;
+    
+    // 8 output samples of every beam per iteration, one int16x8 load per
+    // tap feeding two Q31 accumulators
+    for (; i + 8 <= length; i += 8) {
+        for (int b = 0; b < beams; b++) {
+            const int16_t* const* t = taps + b * count;
+            const int16_t (*w)[FRACTIONAL_DELAY_TAPS] = weights + b * count;
+            int32x4_t accLo = vdupq_n_s32(0);
+            int32x4_t accHi = vdupq_n_s32(0);
+            
+            for (int c = 0; c < count; c++) {
+                const int16_t* x = t[c] + i;
+                for (int k = 0; k < FRACTIONAL_DELAY_TAPS; k++) {
+                    int16x8_t v = vld1q_s16(x + k);
+                    accLo = vqdmlal_n_s16(accLo, vget_low_s16(v), w[c][k]);
+                    accHi = vqdmlal_n_s16(accHi, vget_high_s16(v), w[c][k]);
+                }
+            }
+            
+            vst1q_f32(outputs[b] + i, vcvtq_n_f32_s32(accLo, 31));
+            vst1q_f32(outputs[b] + i + 4, vcvtq_n_f32_s32(accHi, 31));
+        }
+    }
+    
+    // Remaining samples
+    if (i < length) {
+        const int16_t* tail[(MAX_BEAMS + 1) * MAX_CHANNELS];
+        float* tailOut[MAX_BEAMS + 1];
+        for (int b = 0; b < beams; b++) {
+            for (int c = 0; c < count; c++) {
+                tail[b * count + c] = taps[b * count + c] + i;
+            }
+            tailOut[b] = outputs[b] + i;
+        }
+        delaySumQ15Scalar<Channels>(tail, weights, tailOut, beams, length - i, channels);
+    }
+#else
+    delaySumQ15Scalar<Channels>(taps, weights, outputs, beams, length, channels);
+#endif
+}
+
+// Products of two Q15 values fit int32, their sum is kept in 64 bits
+template <bool Neon>
+static int64_t dotQ15(const int16_t* a, const int16_t* b, int length) {
+    int64_t sum = 0;
+    int i = 0;
+#ifdef __ARM_NEON
+    int64x2_t acc = vdupq_n_s64(0);
+    for (; Neon && i + 8 <= length; i += 8) {
+        int16x8_t x = vld1q_s16(a + i);
+        int16x8_t y = vld1q_s16(b + i);
+        acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(x), vget_low_s16(y)));
+        acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(x), vget_high_s16(y)));
+    }
+    sum = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+#endif
+    for (; i < length; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+template <bool Neon>
+static void whitenQ15(const int16_t* in, int16_t* out, int length) {
+    int i = 0;
+#ifdef __ARM_NEON
+    for (; Neon && i + 8 <= length; i += 8) {
+        vst1q_s16(out + i, vhsubq_s16(vld1q_s16(in + i), vld1q_s16(in + i - 1)));
+    }
+#endif
+    for (; i < length; i++) {
+        out[i] = (int16_t)((in[i] - in[i - 1]) >> 1);
+    }
+}
+
+template <int Channels, bool Neon>
+static void steerSum(const fftwf_complex* weights, const fftwf_complex* const* spectra,
+                     fftwf_complex* output, int bins, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    int k = 0;
+#ifdef __ARM_NEON
+    // 4 bins per iteration, real and imaginary parts de-interleaved by vld2q
+    for (; Neon && k + 4 <= bins; k += 4) {
+        float32x4x2_t acc;
+        acc.val[0] = vdupq_n_f32(0.0f);
+        acc.val[1] = vdupq_n_f32(0.0f);
+        for (int c = 0; c < count; c++) {
+            float32x4x2_t w = vld2q_f32(weights[c * bins + k]);
+            float32x4x2_t x = vld2q_f32(spectra[c][k]);
+            acc.val[0] = mulSub(mulAdd(acc.val[0], w.val[0], x.val[0]), w.val[1], x.val[1]);
+            acc.val[1] = mulAdd(mulAdd(acc.val[1], w.val[0], x.val[1]), w.val[1], x.val[0]);
+        }
+        vst2q_f32(output[k], acc);
+    }
+#endif
+    for (; k < bins; k++) {
+        float re = 0.0f;
+        float im = 0.0f;
+        for (int c = 0; c < count; c++) {
+            const float* w = weights[c * bins + k];
+            const float* x = spectra[c][k];
+            re += w[0] * x[0] - w[1] * x[1];
+            im += w[0] * x[1] + w[1] * x[0];
+        }
+        output[k][0] = re;
+        output[k][1] = im;
+    }
+}
+
+// Exponentially smoothed xj * conj(xi), the cross-spectrum of one mic pair
+// or, with i == j, one mic's power
+template <bool Neon>
+static void smoothCross(const fftwf_complex* xi, const fftwf_complex* xj, fftwf_complex* s, int bins, float alpha) {
+    int k = 0;
+#ifdef __ARM_NEON
+    const float32x4_t a = vdupq_n_f32(alpha);
+    const float32x4_t b = vdupq_n_f32(1.0f - alpha);
+    for (; Neon && k + 4 <= bins; k += 4) {
+        float32x4x2_t u = vld2q_f32(xi[k]);
+        float32x4x2_t v = vld2q_f32(xj[k]);
+        float32x4x2_t acc = vld2q_f32(s[k]);
+        float32x4_t re = mulAdd(vmulq_f32(v.val[0], u.val[0]), v.val[1], u.val[1]);
+        float32x4_t im = mulSub(vmulq_f32(v.val[1], u.val[0]), v.val[0], u.val[1]);
+        acc.val[0] = mulAdd(vmulq_f32(a, acc.val[0]), b, re);
+        acc.val[1] = mulAdd(vmulq_f32(a, acc.val[1]), b, im);
+        vst2q_f32(s[k], acc);
+    }
+#endif
+    for (; k < bins; k++) {
+        float re = xj[k][0] * xi[k][0] + xj[k][1] * xi[k][1];
+        float im = xj[k][1] * xi[k][0] - xj[k][0] * xi[k][1];
+        s[k][0] = alpha * s[k][0] + (1.0f - alpha) * re;
+        s[k][1] = alpha * s[k][1] + (1.0f - alpha) * im;
+    }
+}
+
+template <int Channels, bool Neon>
+static void crossSpectra(const fftwf_complex* const* spectra, fftwf_complex* const* cross,
+                         int bins, float alpha, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    int p = 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++, p++) {
+            smoothCross<Neon>(spectra[i], spectra[j], cross[p], bins, alpha);
+        }
+    }
+}
+
+// Spatial covariance, term (i, j) for i <= j holds R[j][i] = E[Xj conj(Xi)]
+template <int Channels, bool Neon>
+static void covariance(const fftwf_complex* const* spectra, fftwf_complex* const* cov,
+                       int bins, float alpha, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    int p = 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = i; j < count; j++, p++) {
+            smoothCross<Neon>(spectra[i], spectra[j], cov[p], bins, alpha);
+        }
+    }
+}
+
+#ifdef __ARM_NEON
+static inline float32x4_t divide(float32x4_t n, float32x4_t d) {
+#if defined(__aarch64__)
+    return vdivq_f32(n, d);
+#else
+    float32x4_t r = vrecpeq_f32(d);
+    r = vmulq_f32(r, vrecpsq_f32(d, r));
+    r = vmulq_f32(r, vrecpsq_f32(d, r));
+    return vmulq_f32(n, r);
+#endif
+}
+#endif
+
+// MVDR weights w = R^-1 d / (d^H R^-1 d) per bin for each beam, with
+// d = conj(steering) the delay-and-sum response and R diagonally loaded.
+// Stored as conj(w) * scale so steerSum() applies them like the steering
+// weights; bins without a usable covariance fall back to delay-and-sum.
+// Two mics use the closed-form 2x2 inverse four bins at a time, more mics
+// a Cholesky factorisation per bin shared by all beams.
+#define MVDR_MIN_POWER 1e-30f
+
+template <int Channels, bool Neon>
+static void mvdrSolve(const fftwf_complex* const* cov, const fftwf_complex* const* steering,
+                      fftwf_complex* const* weights, int beams, int bins, float loading, float scale, int channels) {
+    const int count = Channels > 0 ? Channels : channels;
+    int k = 0;
+    
+    if (count == 2) {
+        // R = [a conj(q); q c], adj(R) d gives w up to a real factor
+#ifdef __ARM_NEON
+        const float32x4_t halfLoading = vdupq_n_f32(0.5f * loading);
+        const float32x4_t minPower = vdupq_n_f32(MVDR_MIN_POWER);
+        const float32x4_t gain = vdupq_n_f32(scale);
+        for (; Neon && k + 4 <= bins; k += 4) {
+            float32x4_t a = vld2q_f32(cov[0][k]).val[0];
+            float32x4x2_t q = vld2q_f32(cov[1][k]);
+            float32x4_t c = vld2q_f32(cov[2][k]).val[0];
+            float32x4_t delta = vmulq_f32(vaddq_f32(a, c), halfLoading);
+            a = vaddq_f32(a, delta);
+            c = vaddq_f32(c, delta);
+            
+            for (int b = 0; b < beams; b++) {
+                float32x4x2_t w0 = vld2q_f32(steering[b][k]);
+                float32x4x2_t w1 = vld2q_f32(steering[b][bins + k]);
+                
+                // v0 = c w0 - q w1, v1 = a w1 - conj(q) w0
+                float32x4_t v0r = mulAdd(mulSub(vmulq_f32(c, w0.val[0]), q.val[0], w1.val[0]), q.val[1], w1.val[1]);
+                float32x4_t v0i = mulSub(mulSub(vmulq_f32(c, w0.val[1]), q.val[0], w1.val[1]), q.val[1], w1.val[0]);
+                float32x4_t v1r = mulSub(mulSub(vmulq_f32(a, w1.val[0]), q.val[0], w0.val[0]), q.val[1], w0.val[1]);
+                float32x4_t v1i = mulAdd(mulSub(vmulq_f32(a, w1.val[1]), q.val[0], w0.val[1]), q.val[1], w0.val[0]);
+                
+                // Re(w^H v) = d^H adj(R) d
+                float32x4_t denom = vmulq_f32(w0.val[0], v0r);
+                denom = mulAdd(denom, w0.val[1], v0i);
+                denom = mulAdd(denom, w1.val[0], v1r);
+                denom = mulAdd(denom, w1.val[1], v1i);
+                uint32x4_t usable = vcgtq_f32(denom, minPower);
+                float32x4_t g = divide(gain, denom);
+                
+                float32x4x2_t out0, out1;
+                out0.val[0] = vbslq_f32(usable, vmulq_f32(v0r, g), w0.val[0]);
+                out0.val[1] = vbslq_f32(usable, vmulq_f32(v0i, g), w0.val[1]);
+                out1.val[0] = vbslq_f32(usable, vmulq_f32(v1r, g), w1.val[0]);
+                out1.val[1] = vbslq_f32(usable, vmulq_f32(v1i, g), w1.val[1]);
+                vst2q_f32(weights[b][k], out0);
+                vst2q_f32(weights[b][bins + k], out1);
+            }
+        }
+#endif
+        for (; k < bins; k++) {
+            float a = cov[0][k][0];
+            float qr = cov[1][k][0];
+            float qi = cov[1][k][1];
+            float c = cov[2][k][0];
+            float delta = 0.5f * loading * (a + c);
+            a += delta;
+            c += delta;
+            
+            for (int b = 0; b < beams; b++) {
+                const float* w0 = steering[b][k];
+                const float* w1 = steering[b][bins + k];
+                float v0r = c * w0[0] - qr * w1[0] + qi * w1[1];
+                float v0i = c * w0[1] - qr * w1[1] - qi * w1[0];
+                float v1r = a * w1[0] - qr * w0[0] - qi * w0[1];
+                float v1i = a * w1[1] - qr * w0[1] + qi * w0[0];
+                float denom = w0[0] * v0r + w0[1] * v0i + w1[0] * v1r + w1[1] * v1i;
+                
+                float* out0 = weights[b][k];
+                float* out1 = weights[b][bins + k];
+                if (denom > MVDR_MIN_POWER) {
+                    float g = scale / denom;
+                    out0[0] = v0r * g;
+                    out0[1] = v0i * g;
+                    out1[0] = v1r * g;
+                    out1[1] = v1i * g;
+                } else {
+                    out0[0] = w0[0];
+                    out0[1] = w0[1];
+                    out1[0] = w1[0];
+                    out1[1] = w1[1];
+                }
+            }
+        }
+        return;
+    }
+    
+    for (; k < bins; k++) {
+        // Lower triangle R[i][j], i >= j, sits in covariance term (j, i)
+        float rRe[MAX_CHANNELS][MAX_CHANNELS];
+        float rIm[MAX_CHANNELS][MAX_CHANNELS];
+        float trace = 0.0f;
+        int p = 0;
+        for (int j = 0; j < count; j++) {
+            for (int i = j; i < count; i++, p++) {
+                rRe[i][j] = cov[p][k][0];
+                rIm[i][j] = cov[p][k][1];
+            }
+            trace += rRe[j][j];
+        }
+        
+        // Cholesky R = L L^H, L in place of the lower triangle with real diagonal
+        float invDiag[MAX_CHANNELS];
+        bool usable = trace > MVDR_MIN_POWER;
+        float delta = loading * trace / count;
+        for (int j = 0; j < count && usable; j++) {
+            float d = rRe[j][j] + delta;
+            for (int m = 0; m < j; m++) {
+                d -= rRe[j][m] * rRe[j][m] + rIm[j][m] * rIm[j][m];
+            }
+            if (d <= MVDR_MIN_POWER) {
+                usable = false;
+                break;
+            }
+            invDiag[j] = 1.0f / sqrtf(d);
+            
+            for (int i = j + 1; i < count; i++) {
+                float re = rRe[i][j];
+                float im = rIm[i][j];
+                for (int m = 0; m < j; m++) {
+                    // L[i][m] * conj(L[j][m])
+                    re -= rRe[i][m] * rRe[j][m] + rIm[i][m] * rIm[j][m];
+                    im -= rIm[i][m] * rRe[j][m] - rRe[i][m] * rIm[j][m];
+                }
+                rRe[i][j] = re * invDiag[j];
+                rIm[i][j] = im * invDiag[j];
+            }
+        }
+        
+        for (int b = 0; b < beams; b++) {
+            const fftwf_complex* w = steering[b];
+            fftwf_complex* out = weights[b];
+            
+            float denom = 0.0f;
+            float uRe[MAX_CHANNELS];
+            float uIm[MAX_CHANNELS];
+            if (usable) {
+                // Forward substitution L y = d with d = conj(steering)
+                for (int i = 0; i < count; i++) {
+                    float re = w[i * bins + k][0];
+                    float im = -w[i * bins + k][1];
+                    for (int m = 0; m < i; m++) {
+                        re -= rRe[i][m] * uRe[m] - rIm[i][m] * uIm[m];
+                        im -= rRe[i][m] * uIm[m] + rIm[i][m] * uRe[m];
+                    }
+                    uRe[i] = re * invDiag[i];
+                    uIm[i] = im * invDiag[i];
+                }
+                
+                // Back substitution L^H u = y
+                for (int i = count - 1; i >= 0; i--) {
+                    float re = uRe[i];
+                    float im = uIm[i];
+                    for (int m = i + 1; m < count; m++) {
+                        // conj(L[m][i]) * u[m]
+                        re -= rRe[m][i] * uRe[m] + rIm[m][i] * uIm[m];
+                        im -= rRe[m][i] * uIm[m] - rIm[m][i] * uRe[m];
+                    }
+                    uRe[i] = re * invDiag[i];
+                    uIm[i] = im * invDiag[i];
+                }
+                
+                // Re(d^H u)
+                for (int i = 0; i < count; i++) {
+                    denom += w[i * bins + k][0] * uRe[i] - w[i * bins + k][1] * uIm[i];
+                }
+            }
+            
+            if (denom > MVDR_MIN_POWER) {
+                float g = scale / denom;
+                for (int i = 0; i < count; i++) {
+                    out[i * bins + k][0] = uRe[i] * g;
+                    out[i * bins + k][1] = -uIm[i] * g;
+                }
+            } else {
+                for (int i = 0; i < count; i++) {
+                    out[i * bins + k][0] = w[i * bins + k][0];
+                    out[i * bins + k][1] = w[i * bins + k][1];
+                }
+            }
+        }
+    }
+}
+
+template <int Channels>
+BeamFormer::Kernels BeamFormer::kernelsFor(bool neon) {
+    Kernels k;
+    k.deinterleave = deinterleave<Channels>;
+    k.delaySum = neon ? delaySumNeon<Channels> : delaySumScalar<Channels>;
+    k.steerSum = neon ? steerSum<Channels, true> : steerSum<Channels, false>;
+    k.crossSpectra = neon ? crossSpectra<Channels, true> : crossSpectra<Channels, false>;
+    k.covariance = neon ? covariance<Channels, true> : covariance<Channels, false>;
+    k.mvdrSolve = neon ? mvdrSolve<Channels, true> : mvdrSolve<Channels, false>;
+    k.delaySumQ15 = neon ? delaySumQ15Neon<Channels> : delaySumQ15Scalar<Channels>;
+    k.dotQ15 = neon ? dotQ15<true> : dotQ15<false>;
+    k.whitenQ15 = neon ? whitenQ15<true> : whitenQ15<false>;
+    return k;
+}
+
+// BeamFormerApp implementation
+size_t ringSizeFor(const BeamFormerConfig& config) {
+    size_t channels = std::max(config.geometry.deviceChannels, config.beamCount());
+    size_t block = std::max(config.frameSize, config.rtpDestination.empty() ? 0 : config.rtpPacketFrames);
+    size_t wanted = std::max(config.ringSize, block * channels * 4);
+    size_t size = 1;
+    while (size < wanted) {
+        size <<= 1;
+    }
+    return size;
+}
+
+BeamFormerApp::BeamFormerApp(const std::string& inDevice, const std::string& outDevice, bool enableLogging,
+                             const BeamFormerConfig& cfg) :
+    BeamFormerApp(std::vector<ArrayDevices>(1, ArrayDevices(inDevice, outDevice)), enableLogging, cfg) {
+}
+
+BeamFormerApp::BeamFormerApp(const std::vector<ArrayDevices>& devices, bool enableLogging,
+                             const BeamFormerConfig& cfg) : 
+    arrayDevices(devices),
+    loggingEnabled(enableLogging),
+    config(cfg),
+    running(false) {
+    
+    // Store instance for signal handler
+    instance = this;
+}
+
+BeamFormerApp::~BeamFormerApp() {
+    stop();
+    instance = nullptr;
+}
+
+// RTP port or control socket of array N: array 0 keeps the configured one,
+// the others count up in steps of two ports (RTCP takes the odd one) and
+// append ".N" to the socket path
+static std::string arrayRtpDestination(const std::string& destination, size_t index) {
+    size_t colon = destination.rfind(':');
+    if (index == 0 || colon == std::string::npos) {
+        return destination;
+    }
+    int port = atoi(destination.c_str() + colon + 1);
+    return destination.substr(0, colon + 1) + std::to_string(port + 2 * (int)index);
+}
+
+static std::string arrayControlPath(const std::string& path, size_t index) {
+    if (index == 0 || path.empty()) {
+        return path;
+    }
+    return path + "." + std::to_string(index);
+}
+
+std::string BeamFormerApp::arrayLabel(size_t index) const {
+    if (arrays.size() < 2) {
+        return "";
+    }
+    return "Array " + std::to_string(index) + " ";
+}
+
+bool BeamFormerApp::init() {
+    // Create logger first with specified logging state
+    logger = std::make_unique<Logger>(true, loggingEnabled);
+    
+    if (!logger) {
+        fprintf(stderr, "Failed to create logger\n");
+        return false;
+    }
+    
+    logger->log(LOG_INFO, "Initializing BeamFormer application");
+    
+    if (arrayDevices.empty() || arrayDevices.size() > MAX_ARRAYS) {
+        logger->log(LOG_ERR, "One process runs 1-" + std::to_string(MAX_ARRAYS) + " arrays, got " +
+                   std::to_string(arrayDevices.size()));
+        return false;
+    }
+    
+    // Lock early so every buffer allocated below is resident and locked
+    if (config.lockMemory) {
+        lockProcessMemory(logger.get());
+    }
+    
+    // Create error handler
+    errorHandler = std::make_unique<ErrorHandler>(logger.get());
+    
+    if (!errorHandler) {
+        logger->log(LOG_ERR, "Failed to create error handler");
+        return false;
+    }
+    
+    // The network sink reads its own ring, the fused loop has none
+    if (!config.rtpDestination.empty() && config.pipelineMode == PIPELINE_FUSED) {
+        logger->log(LOG_ERR, "RTP output needs the threaded pipeline");
+        return false;
+    }
+    
+    // The fused loop is the processing thread of its array, it cannot be pooled
+    if (arrayDevices.size() > 1 && config.pipelineMode == PIPELINE_FUSED) {
+        logger->log(LOG_ERR, "Several arrays need the threaded pipeline");
+        return false;
+    }
+    
+    dspCache = std::make_unique<DspCache>();
+    
+    size_t ringSize = ringSizeFor(config);
+    for (size_t i = 0; i < arrayDevices.size(); i++) {
+        arrays.push_back(std::make_unique<ArrayPipeline>(arrayDevices[i]));
+        ArrayPipeline& array = *arrays.back();
+        array.rtpDestination = arrayRtpDestination(config.rtpDestination, i);
+        array.controlPath = arrayControlPath(config.controlSocket, i);
+        
+        if (!initArray(array, ringSize)) {
+            if (arrays.size() > 1) {
+                logger->log(LOG_ERR, "Failed to initialize array " + std::to_string(i) + " on " + array.devices.input);
+            }
+            return false;
+        }
+    }
+    
+    if (arrays.size() > 1) {
+        logger->log(LOG_INFO, std::to_string(arrays.size()) + " arrays share " +
+                   std::to_string(dspCache->planCount()) + " FFT plans and " +
+                   std::to_string(dspCache->steeringCount()) + " steering tables");
+    }
+    
+    // One worker per core at most, and never more than there are arrays
+    if (arrays.size() > 1 && config.pipelineMode == PIPELINE_THREADED) {
+        int workers = config.workerThreads > 0 ? config.workerThreads : WorkerPool::onlineCpus();
+        workers = std::min(workers, (int)arrays.size());
+        workerPool = std::make_unique<WorkerPool>(workers, config.processRt, logger.get());
+        for (size_t i = 0; i < arrays.size(); i++) {
+            if (!workerPool->add(arrays[i]->beamformer.get())) {
+                logger->log(LOG_ERR, "Worker pool cannot take array " + std::to_string(i));
+                return false;
+            }
+        }
+    }
+    
+    logger->log(LOG_INFO, "Frame " + std::to_string(config.frameSize) + " samples (" +
+               std::to_string(config.frameSize * 1000000 / SAMPLE_RATE) + " us), " +
+               std::to_string(config.periods) + " periods, ring " + std::to_string(ringSize) + " samples");
+    
+    // Set up signal handler
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    
+    logger->log(LOG_INFO, "BeamFormer application initialized successfully");
+    return true;
+}
+
+bool BeamFormerApp::initArray(ArrayPipeline& array, size_t ringSize) {
+    array.stats = std::make_unique<PipelineStats>(config.frameSize);
+    
+    // Create circular buffers, the fused pipeline hands frames over directly
+    if (config.pipelineMode == PIPELINE_THREADED) {
+        bool ringEvents = config.ioMode == IO_MODE_EVENT;
+        array.captureToBeamformer = std::make_unique<CircularBuffer>(ringSize, ringEvents);
+        array.beamformerToOutput = std::make_unique<CircularBuffer>(ringSize, ringEvents);
+        
+        if (!array.captureToBeamformer || !array.beamformerToOutput) {
+            logger->log(LOG_ERR, "Failed to create circular buffers");
+            return false;
+        }
+    }
+    
+    // Create components
+    array.audioCapture = std::make_unique<AudioCapture>(array.devices.input, array.captureToBeamformer.get(),
+                                                        errorHandler.get(), logger.get(), array.stats.get());
+    array.beamformer = std::make_unique<BeamFormer>(array.captureToBeamformer.get(), array.beamformerToOutput.get(),
+                                                    errorHandler.get(), logger.get(), config, array.stats.get());
+    if (array.rtpDestination.empty()) {
+        array.alsaOutput = std::make_unique<AlsaOutput>(array.devices.output, array.beamformerToOutput.get(),
+                                                        errorHandler.get(), logger.get(), array.stats.get());
+    } else {
+        array.rtpSink = std::make_unique<RtpSink>(array.rtpDestination, array.beamformerToOutput.get(), logger.get(),
+                                                  array.stats.get());
+    }
+    
+    if (!array.audioCapture || !array.beamformer || (!array.alsaOutput && !array.rtpSink)) {
+        logger->log(LOG_ERR, "Failed to create components");
+        return false;
+    }
+    
+    array.audioCapture->setRtConfig(config.captureRt);
+    array.audioCapture->setIoMode(config.ioMode);
+    array.audioCapture->setMmap(config.useMmap);
+    array.audioCapture->setChannels(config.geometry.deviceChannels);
+    array.audioCapture->setPeriodSize(config.frameSize, config.periods);
+    array.audioCapture->setSampleFormat(config.sampleFormat);
+    
+    array.beamformer->setDspCache(dspCache.get());
+    
+    if (array.alsaOutput) {
+        array.alsaOutput->setRtConfig(config.outputRt);
+        array.alsaOutput->setIoMode(config.ioMode);
+        array.alsaOutput->setMmap(config.useMmap);
+        array.alsaOutput->setChannels(config.beamCount());
+        array.alsaOutput->setPeriodSize(config.frameSize, config.periods);
+        array.alsaOutput->setSampleFormat(config.sampleFormat);
+    } else {
+        array.rtpSink->setRtConfig(config.outputRt);
+        array.rtpSink->setChannels(config.beamCount());
+        array.rtpSink->setPacketFrames(config.rtpPacketFrames);
+        if (config.rtpAngle) {
+            array.rtpSink->setAngleSource(array.beamformer.get());
+        }
+    }
+    
+    // Initialize components
+    if (!array.audioCapture->init()) {
+        logger->log(LOG_ERR, "Failed to initialize audio capture");
         return false;
     }
     
+    if (!array.beamformer->init()) {
+        logger->log(LOG_ERR, "Failed to initialize beamformer");
+        return false;
+    }
+    
+    if (array.alsaOutput && !array.alsaOutput->init()) {
+        logger->log(LOG_ERR, "Failed to initialize ALSA output");
+        return false;
+    }
+    
+    if (array.rtpSink && !array.rtpSink->init()) {
+        logger->log(LOG_ERR, "Failed to initialize RTP output");
+        return false;
+    }
+    
+    // The fused loop moves exactly one frame per device period, the rings
+    // only need room for two periods of whatever the devices settled on
+    size_t capturePeriod = array.audioCapture->getPeriodSize();
+    size_t outputPeriod = array.alsaOutput ? array.alsaOutput->getPeriodSize() : (size_t)array.rtpSink->getPacketFrames();
+    if (config.pipelineMode == PIPELINE_FUSED) {
+        if (capturePeriod != (size_t)config.frameSize || outputPeriod != (size_t)config.frameSize) {
+            logger->log(LOG_ERR, "Fused pipeline needs device periods of " + std::to_string(config.frameSize) +
+                       " frames, got capture " + std::to_string(capturePeriod) +
+                       " and output " + std::to_string(outputPeriod));
+            return false;
+        }
+    } else if (std::max(capturePeriod, (size_t)config.frameSize) * config.geometry.deviceChannels * 2 > ringSize ||
+               std::max(outputPeriod, (size_t)config.frameSize) * config.beamCount() * 2 > ringSize) {
+        logger->log(LOG_ERR, "Ring of " + std::to_string(ringSize) + " samples is too small for device periods of " +
+                   std::to_string(capturePeriod) + " and " + std::to_string(outputPeriod) + " frames");
+        return false;
+    }
+    
+    if (!allocateFrameBuffers(array)) {
+        return false;
+    }
+    
+    // Capture and playback clocks drift apart unless they share a crystal.
+    // The fused loop moves one period each way per cycle and cannot absorb it.
+    // An RTP receiver plays at its own clock and compensates itself.
+    if (config.driftCompensation && array.alsaOutput) {
+        if (config.pipelineMode == PIPELINE_THREADED) {
+            array.alsaOutput->enableDriftCompensation(array.audioCapture->getSampleRate());
+        } else {
+            logger->log(LOG_INFO, "Drift compensation needs the threaded pipeline, devices must share a clock");
+        }
+    }
+    
+    return true;
+}
+
+bool BeamFormerApp::start() {
+    if (running) {
+        return true;
+    }
+    
+    logger->log(LOG_INFO, "Starting BeamFormer application");
+    
+    if (config.pipelineMode == PIPELINE_FUSED) {
+        ArrayPipeline& array = *arrays[0];
+        array.alsaOutput->startExternal();
+        array.audioCapture->startExternal();
+        running = true;
+        fusedThread = std::thread(&BeamFormerApp::fusedLoop, this);
+        
+        if (!errorHandler->startWatchdog()) {
+            logger->log(LOG_WARNING, "Failed to start watchdog");
+        }
+        
+        startControlSocket(array);
+        
+        logger->log(LOG_INFO, "BeamFormer application started (fused pipeline)");
+        return true;
+    }
+    
+    // The workers wait on the capture rings, so they can run before capture
+    if (workerPool && !workerPool->start()) {
+        logger->log(LOG_ERR, "Failed to start worker pool");
+        return false;
+    }
+    
+    for (size_t i = 0; i < arrays.size(); i++) {
+        if (!startArray(*arrays[i])) {
+            return false;
+        }
+    }
+    
     // Start watchdog
     if (!errorHandler->startWatchdog()) {
         logger->log(LOG_WARNING, "Failed to start watchdog");
     }
     
+    for (size_t i = 0; i < arrays.size(); i++) {
+        startControlSocket(*arrays[i]);
+    }
+    
     running = true;
     logger->log(LOG_INFO, "BeamFormer application started");
     return true;
 }
 
+bool BeamFormerApp::startArray(ArrayPipeline& array) {
+    // Start components in reverse order to ensure buffers are ready
+    if (array.alsaOutput && !array.alsaOutput->start()) {
+        logger->log(LOG_ERR, "Failed to start ALSA output");
+        return false;
+    }
+    
+    if (array.rtpSink && !array.rtpSink->start()) {
+        logger->log(LOG_ERR, "Failed to start RTP output");
+        return false;
+    }
+    
+    if (!workerPool && !array.beamformer->start()) {
+        logger->log(LOG_ERR, "Failed to start beamformer");
+        return false;
+    }
+    
+    if (!array.audioCapture->start()) {
+        logger->log(LOG_ERR, "Failed to start audio capture");
+        return false;
+    }
+    
+    return true;
+}
+
 void BeamFormerApp::stop() {
     if (!running) {
         return;
@@ -376,45 +2118,208 @@ void BeamFormerApp::stop() {
     // Set running to false first to prevent multiple stops
     running = false;
     
+    // No more runtime commands while the components shut down
+    for (size_t i = 0; i < arrays.size(); i++) {
+        if (arrays[i]->controlSocket) arrays[i]->controlSocket->stop();
+    }
+    
     // Close buffers first to unstick any waiting threads
-    if (captureToBeamformer) captureToBeamformer->close();
-    if (beamformerToOutput) beamformerToOutput->close();
+    for (size_t i = 0; i < arrays.size(); i++) {
+        if (arrays[i]->captureToBeamformer) arrays[i]->captureToBeamformer->close();
+        if (arrays[i]->beamformerToOutput) arrays[i]->beamformerToOutput->close();
+    }
     
     // Stop components in order
     if (errorHandler) errorHandler->stopWatchdog();
     
-    if (audioCapture) {
-        audioCapture->setState(STATE_TERMINATING);
-        audioCapture->stop();
+    for (size_t i = 0; i < arrays.size(); i++) {
+        if (arrays[i]->audioCapture) {
+            arrays[i]->audioCapture->setState(STATE_TERMINATING);
+            arrays[i]->audioCapture->stop();
+        }
     }
     
-    if (beamformer) {
-        beamformer->setState(STATE_TERMINATING);
-        beamformer->stop();
+    // With capture stopped the fused thread finishes its period and exits;
+    // the workers stop at their next pass, like the processing threads,
+    // dropping whatever the closed rings still hold
+    if (fusedThread.joinable()) {
+        fusedThread.join();
     }
+    if (workerPool) workerPool->stop();
     
-    if (alsaOutput) {
-        alsaOutput->setState(STATE_TERMINATING);
-        alsaOutput->stop();
+    for (size_t i = 0; i < arrays.size(); i++) {
+        stopArray(*arrays[i]);
     }
     
     logger->log(LOG_INFO, "BeamFormer application stopped");
 }
 
-void BeamFormerApp::waitForExit() {
+void BeamFormerApp::stopArray(ArrayPipeline& array) {
+    if (array.beamformer) {
+        array.beamformer->setState(STATE_TERMINATING);
+        array.beamformer->stop();
+    }
+    
+    if (array.alsaOutput) {
+        array.alsaOutput->setState(STATE_TERMINATING);
+        array.alsaOutput->stop();
+    }
+    
+    if (array.rtpSink) array.rtpSink->stop();
+}
+
+bool BeamFormerApp::allocateFrameBuffers(ArrayPipeline& array) {
+    // A period for each device thread plus the frame pair of whichever
+    // thread runs processFrame()
+    size_t captureSamples = array.audioCapture->getPeriodSize() * array.audioCapture->getChannels();
+    size_t outputSamples = array.alsaOutput ? array.alsaOutput->getPeriodSize() * array.alsaOutput->getChannels() : 0;
+    size_t inFrame = (size_t)config.frameSize * config.geometry.deviceChannels;
+    size_t outFrame = (size_t)config.frameSize * config.beamCount();
+    size_t bytes = RtArena::bytesFor<float>(captureSamples) + RtArena::bytesFor<float>(outputSamples) +
+                   RtArena::bytesFor<float>(inFrame) + RtArena::bytesFor<float>(outFrame);
+    
+    array.frameArena = std::make_unique<RtArena>(bytes);
+    if (!array.frameArena->valid()) {
+        logger->log(LOG_ERR, "Failed to allocate frame arena of " + std::to_string(bytes) + " bytes");
+        return false;
+    }
+    
+    array.audioCapture->setScratch(array.frameArena->allocate<float>(captureSamples));
+    if (array.alsaOutput) array.alsaOutput->setScratch(array.frameArena->allocate<float>(outputSamples));
+    float* in = array.frameArena->allocate<float>(inFrame);
+    float* out = array.frameArena->allocate<float>(outFrame);
+    if (config.pipelineMode == PIPELINE_FUSED) {
+        array.fusedInput = in;
+        array.fusedOutput = out;
+    } else {
+        array.beamformer->setScratch(in, out);
+    }
+    
+    logger->log(LOG_INFO, "Frame arena " + std::to_string(array.frameArena->bytesUsed()) + " bytes");
+    return true;
+}
+
+void BeamFormerApp::startControlSocket(ArrayPipeline& array) {
+    if (array.controlPath.empty()) {
+        return;
+    }
+    
+    // Audio runs without it, runtime control is a convenience
+    array.controlSocket = std::make_unique<ControlSocket>(array.controlPath, array.beamformer.get(), logger.get(),
+                                                          array.stats.get());
+    if (!array.controlSocket->start()) {
+        logger->log(LOG_WARNING, "Runtime control unavailable");
+        array.controlSocket.reset();
+    }
+}
+
+void BeamFormerApp::fusedLoop() {
+    logger->log(LOG_INFO, "Fused pipeline thread started");
+    
+    ArrayPipeline& array = *arrays[0];
+    AudioCapture* audioCapture = array.audioCapture.get();
+    BeamFormer* beamformer = array.beamformer.get();
+    AlsaOutput* alsaOutput = array.alsaOutput.get();
+    PipelineStats* stats = array.stats.get();
+    
+    applyThreadRtConfig(config.processRt, "Fused", logger.get());
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    enterRtSection();
+    
+    alsaOutput->prebuffer();
+    
+    while (running && audioCapture->isRunning()) {
+        // Restart only the stage that failed, the others carry on
+        if ((audioCapture->getState() == STATE_ERROR && !audioCapture->restartStream()) ||
+            (alsaOutput->getState() == STATE_ERROR && !alsaOutput->restartStream())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(RECOVERY_RETRY_MS));
+            continue;
+        }
+        if (beamformer->getState() == STATE_ERROR) {
+            beamformer->restartProcessing();
+        }
+        
+        // Capture straight into the frame the beamformer reads, with mmap
+        // access converted directly out of the DMA buffer
+        float* in = array.fusedInput;
+        snd_pcm_sframes_t frames = audioCapture->readPeriod(in);
+        if (frames < 0) {
+            errorHandler->reportError(ERROR_ALSA_XRUN, snd_strerror(frames));
+            continue;
+        }
+        if (frames < config.frameSize) {
+            continue;  // Stopping
+        }
+        
+        float* out = array.fusedOutput;
+        uint64_t startUs = PipelineStats::nowUs();
+        if (beamformer->processFrame(in, out)) {
+            stats->recordStage(STAGE_PROCESS, startUs);
+        } else {
+            memset(out, 0, config.frameSize * config.beamCount() * sizeof(float));
+        }
+        
+        startUs = PipelineStats::nowUs();
+        alsaOutput->writePeriod(out);
+        stats->recordStage(STAGE_OUTPUT, startUs);
+    }
+    
+    leaveRtSection();
+    logger->log(LOG_INFO, "Fused pipeline thread stopped");
+}
+
+void BeamFormerApp::waitForExit(int timeoutMs) {
     logger->log(LOG_INFO, "Waiting for exit signal");
     
+    auto lastSummary = std::chrono::steady_clock::now();
+    auto deadline = lastSummary + std::chrono::milliseconds(timeoutMs);
+    
     while (running && !sig_received) {
+        if (timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         
         // Ping watchdog
         if (errorHandler) {
             errorHandler->pingWatchdog();
         }
+        
+        // Report events queued by the real-time threads
+        for (size_t i = 0; i < arrays.size(); i++) {
+            arrays[i]->beamformer->drainEvents();
+        }
+        
+        // Full report on request, short summary line every statsInterval seconds
+        bool report = statsRequested.exchange(false);
+        auto now = std::chrono::steady_clock::now();
+        bool summary = config.statsInterval > 0 && now - lastSummary >= std::chrono::seconds(config.statsInterval);
+        if (summary) {
+            lastSummary = now;
+        }
+        
+        for (size_t i = 0; i < arrays.size(); i++) {
+            std::string label = arrayLabel(i);
+            if (report) {
+                logger->report((label.empty() ? "" : label + "(" + arrays[i]->devices.input + ")\n") +
+                               arrays[i]->stats->report());
+            }
+            if (summary) {
+                logger->report((label.empty() ? "Stats: " : label + "stats: ") + arrays[i]->stats->summaryLine());
+            }
+        }
     }
 }
 
 void BeamFormerApp::sigHandler(int sig) {
+    // Statistics are dumped by waitForExit(), not from signal context
+    if (sig == SIGUSR1) {
+        statsRequested = true;
+        return;
+    }
+    
     // Set the signal flag
     sig_received = true;
     
@@ -8,11 +8,51 @@
 #include <vector>
 #include <signal.h>
 #include "beamformer_defs.h"
+#include "beamformer_config.h"
 #include "circular_buffer.h"
+#include "spsc_queue.h"
+#include "mailbox.h"
 #include "error_handler.h"
 #include "logger.h"
+#include "pipeline_stats.h"
 #include "audio_capture.h"
 #include "alsa_output.h"
+#include "control_socket.h"
+#include "rtp_sink.h"
+#include "rt_arena.h"
+#include "dsp_cache.h"
+#include "worker_pool.h"
+
+// Steering change published by the processing thread for non-RT consumers
+struct SteeringEvent {
+    int previousAngle;
+    int newAngle;
+};
+
+// Runtime change requested by a non-RT thread, applied at the next frame
+enum ControlCommandType {
+    CONTROL_STEER,   // value: angle on the grid, -1 to follow the DOA estimate
+    CONTROL_ENGINE   // value: BeamformerEngine
+};
+
+struct ControlCommand {
+    ControlCommandType type;
+    int value;
+};
+
+// Snapshot of the processing state, published after every DOA decision
+// and every applied command
+struct BeamFormerStatus {
+    int doaAngle;             // Latest DOA estimate, -1 before the first
+    int fixedAngle;           // Steering override, -1 when following DOA
+    BeamformerEngine engine;
+    int angleCount;
+    float doaScores[MAX_DOA_ANGLES];
+    bool voiceActive;
+    bool passthrough;         // Idle, beamforming bypassed
+    float levelDb;            // Last frame, mean square dBFS
+    float noiseFloorDb;
+};
 
 class BeamFormer {
 private:
@@ -21,93 +61,375 @@ private:
     std::thread processingThread;
     std::atomic<bool> running;
     std::atomic<AppState> state;
-    std::atomic<int> currentSteeringAngle;  // 0-180 degrees
+    std::atomic<int> currentSteeringAngle;  // Index on the angle grid being rendered
+    std::atomic<int> targetSteeringAngle;   // Angle the next frame fades towards
+    SpscQueue<SteeringEvent, 64> steeringEvents;
+    SpscQueue<ControlCommand, 16> controlCommands;
+    Mailbox<BeamFormerStatus> statusMailbox;
+    BeamFormerConfig config;
+    int frameCount;
+    int doaAngle;    // Latest DOA estimate, processing thread only
+    int fixedAngle;  // Steering override, -1 when following DOA
+    
+    // Sizes fixed at construction: samples per channel and frame, and the
+    // FFT (next power of two of twice the frame, so overlap-save hops by one frame)
+    int frameSize;
+    int fftSize;
+    int fftBins;
+    
+    // Array layout fixed at construction
+    int numChannels;                 // Mics beamformed
+    int inputChannels;               // Interleaved channels per input frame
+    int channelMap[MAX_CHANNELS];    // Input channel of each mic
+    int angleCount;                  // Steering and DOA grid, 181 or 360 angles
+    int pairCount;                   // Mic pairs combined by SRP-PHAT
+    
+    // Output beams: beam 0 follows the DOA estimate, beams 1.. stay on
+    // fixed angles. All of them are rendered in one pass per frame.
+    int beamCount;
+    int beamAngles[MAX_BEAMS];
     
     // DSP resources
     struct DspResources {
-        fftwf_plan fftPlanFwd[NUM_CHANNELS];
+        // Real-to-complex forward and complex-to-real backward plans, owned
+        // by the DspCache and run on these buffers with new-array execute
+        fftwf_plan fftPlanFwd;
         fftwf_plan fftPlanBwd;
-        fftwf_complex *fftIn[NUM_CHANNELS];
-        fftwf_complex *fftOut[NUM_CHANNELS];
-        fftwf_complex *fftProcessed;
+        float *fftIn[MAX_CHANNELS];           // fftSize real samples
+        fftwf_complex *fftOut[MAX_CHANNELS];  // fftBins bins
+        fftwf_complex *fftProcessed;          // fftBins bins, destroyed by fftPlanBwd
+        float *fftResult;                     // fftSize real samples
+        
+        // SRP-PHAT state: analysis window and smoothed cross-spectrum of
+        // every mic pair (0,1), (0,2) ... (1,2) ...
+        std::vector<float> doaWindow;
+        fftwf_complex *crossSpectrum[MAX_MIC_PAIRS];
+        
+        // Correlation of every pair at lags -MAX_STEERING_DELAY ...
+        // MAX_STEERING_DELAY, from either engine's DOA, for scoring
+        std::vector<float> pairCorrelation[MAX_MIC_PAIRS];
+        
+        // Overlap-save state for frequency-domain beamforming: the last
+        // fftSize input samples per channel and their spectrum
+        float *osBlock[MAX_CHANNELS];
+        fftwf_complex *osSpectrum[MAX_CHANNELS];
+        
+        // Delay taps and per-bin phase weights for every angle, computed
+        // once at init and shared with instances steering the same array
+        std::shared_ptr<const SteeringTables> steering;
         
-        // Delay line for time-domain beamforming
-        std::vector<float> delayLine[NUM_CHANNELS];
-        size_t delayLinePos[NUM_CHANNELS];
+        // MVDR state: smoothed spatial covariance of the overlap-save spectra,
+        // terms (0,0), (0,1) ... (1,1) ..., and the weights last solved for
+        // each angle being rendered, [slot][channel][bin] with MAX_BEAMS + 1
+        // slots so a crossfade has the previous angle too
+        fftwf_complex *covariance[MAX_COVARIANCE_TERMS];
+        fftwf_complex *mvdrWeights;
+        
+        // Steering crossfade: raised-cosine gain ramp over one frame and
+        // scratch output rendered with the previous angle
+        std::vector<float> fadeRamp;
+        std::vector<float> fadeBuffer;
+        
+        // Per-beam output, interleaved into the output frame when there
+        // is more than one beam
+        std::vector<float> beamBuffer[MAX_BEAMS];
+        
+        // Passthrough output crossfaded against the beamformer when idle
+        // mode is entered or left
+        std::vector<float> passthroughBuffer;
+        
+        // Delay line for time-domain beamforming: DELAY_LINE_HISTORY samples
+        // carried over from the previous frame followed by the current frame
+        std::vector<float> delayLine[MAX_CHANNELS];
+        
+        // Fixed-point engine: Q15 copies of the delay lines, the same samples
+        // first-differenced for the DOA with Q15_DOA_HISTORY of history, and
+        // the smoothed correlation of every pair at lags -MAX_STEERING_DELAY
+        // ... MAX_STEERING_DELAY with the energy of each differenced channel
+        std::vector<int16_t> q15Line[MAX_CHANNELS];
+        std::vector<int16_t> q15DoaLine[MAX_CHANNELS];
+        std::vector<float> q15Correlation[MAX_MIC_PAIRS];
+        float q15Energy[MAX_CHANNELS];
         
         DspResources();
         ~DspResources();
-        bool init();
+        bool init(DspCache* cache, unsigned planFlags, int frameSize, int fftSize, int channels, int pairs,
+                  int beams);
     };
     
     std::unique_ptr<DspResources> dspResources;
     
+    // Plans and steering tables, from setDspCache() or private
+    DspCache* dspCache;
+    std::unique_ptr<DspCache> ownDspCache;
+    
+    // Frame buffers for ring reads and writes that wrap, handed in through
+    // setScratch() or allocated by start()
+    float* inScratch;
+    float* outScratch;
+    std::vector<float> ownScratch;
+    
     // DOA estimation
     float doaScores[MAX_DOA_ANGLES];
-    int delayPerAngle[MAX_DOA_ANGLES];
+    float arrivalDelay[MAX_DOA_ANGLES][MAX_CHANNELS];  // Per-mic arrival time in fractional samples
+    int pairLag[MAX_DOA_ANGLES][MAX_MIC_PAIRS];        // Lag of the second mic of each pair, whole samples
+    int pairLagSpan[MAX_MIC_PAIRS];                    // Largest |pairLag| + 1, at most MAX_STEERING_DELAY
+    
+    // Angles whose pairs all have the same whole-sample lags score alike, so
+    // each distinct set is scored once. lagSetAngle[set] is the first angle
+    // of a set, angleLagSet[angle] the set of an angle.
+    int lagSetCount;
+    int lagSetAngle[MAX_DOA_ANGLES];
+    int angleLagSet[MAX_DOA_ANGLES];
+    float lagSetScore[MAX_DOA_ANGLES];
+    
+    // Voice activity: frame energy from the de-interleave pass against a
+    // noise floor that falls quickly and rises slowly
+    float frameEnergy;        // Mean square per mic sample
+    float noiseFloor;         // 0 until the first frame
+    float vadRatio;           // Energy ratio over the floor that counts as voice
+    float vadMinEnergy;
+    float floorRise;          // Per-frame noise floor growth factor
+    int vadHangoverFrames;
+    int vadHangover;          // Frames left in the voice state
+    int idleFrames;           // Quiet frames before passthrough, 0 = never
+    int quietFrames;
+    bool voiceActive;
+    bool passthrough;
+    
+    // MVDR weight schedule
+    int mvdrAngle[MAX_BEAMS + 1];  // Angle each weight slot was solved for, -1 if none
+    int mvdrFrameCount;
+    
+    // Inner loops compiled for a fixed channel count (2, 4, 6 or 8) so they
+    // unroll and vectorise fully, or for any count, picked at construction.
+    // deinterleave returns the sum of squares of the mic samples it moved.
+    // delaySum renders several beams in one pass over the delay lines:
+    // taps[b * channels + c] points at the oldest sample of channel c
+    // contributing to output 0 of beam b, weights[] holds its fractional
+    // delay FIR in the same layout. The Q15 forms accumulate Q31 with
+    // saturation and write float; dotQ15 is exact, whitenQ15 writes the
+    // halved first difference and reads in[-1].
+    struct Kernels {
+        float (*deinterleave)(const float* input, const int* map, int stride, float* const* lines,
+                              int length, int channels);
+        void (*delaySum)(const float* const* taps, const float (*weights)[FRACTIONAL_DELAY_TAPS],
+                         float* const* outputs, int beams, int length, int channels);
+        void (*steerSum)(const fftwf_complex* weights, const fftwf_complex* const* spectra,
+                         fftwf_complex* output, int bins, int channels);
+        void (*crossSpectra)(const fftwf_complex* const* spectra, fftwf_complex* const* cross,
+                             int bins, float alpha, int channels);
+        void (*covariance)(const fftwf_complex* const* spectra, fftwf_complex* const* cov,
+                           int bins, float alpha, int channels);
+        void (*mvdrSolve)(const fftwf_complex* const* cov, const fftwf_complex* const* steering,
+                          fftwf_complex* const* weights, int beams, int bins, float loading, float scale,
+                          int channels);
+        void (*delaySumQ15)(const int16_t* const* taps, const int16_t (*weights)[FRACTIONAL_DELAY_TAPS],
+                            float* const* outputs, int beams, int length, int channels);
+        int64_t (*dotQ15)(const int16_t* a, const int16_t* b, int length);
+        void (*whitenQ15)(const int16_t* in, int16_t* out, int length);
+    };
+    Kernels kernels;
+    template <int Channels> static Kernels kernelsFor(bool neon);
     
     // ARM NEON optimization flags
     bool useNeon;
     
     ErrorHandler* errorHandler;
     Logger* logger;
+    PipelineStats* stats;  // Optional, may be null
     
     // Processing functions
     void calculateDelaysForAngles();
-    void processFrameTimeDomain(const int16_t* input, int16_t* output);
-    void processFrameFrequencyDomain(const int16_t* input, int16_t* output);
-    int estimateDOA(const int16_t* input);
+    void channelDelays(int angle, float* delays) const;
+    void calculateSteeringWeights(SteeringTables& tables);
+    float loadDelayLines(const float* input);
+    void updateVoiceActivity(float energy);
+    void renderPassthrough(float* output);
+    void processFrameTimeDomain(float* output);
+    void processFrameFrequencyDomain(float* output);
+    void loadFixedPointLines(const float* const* lines);
+    void resetFixedPoint();
+    
+    // Render 'beams' mono frames steered to angles[b] into outputs[b]
+    void steerTimeDomain(const int* angles, float* const* outputs, int beams);
+    void steerFrequencyDomain(const int* angles, float* const* outputs, int beams);
+    void steerFixedPoint(const int* angles, float* const* outputs, int beams);
+    void updateMvdrWeights();
+    void resetMvdr();
+    const fftwf_complex* frequencyWeights(int angle) const;
+    void renderSteered(void (BeamFormer::*steer)(const int*, float* const*, int), float* output);
+    void updateCrossSpectrum();
+    void updateCorrelationQ15();
+    void correlatePhat();
+    void correlateFixedPoint();
+    int estimateDOA();
     void updateSteering(int angle);
+    void applyControlCommands();
+    void publishStatus();
     void processingLoop();
-    
-    // NEON-optimized functions
-    void applyWeightsNeon(const int16_t* input, int16_t* output, int length);
+    void processQueuedFrame();
     
 public:
     BeamFormer(CircularBuffer* inBuf, CircularBuffer* outBuf, 
-              ErrorHandler* errHandler, Logger* log);
+              ErrorHandler* errHandler, Logger* log,
+              const BeamFormerConfig& cfg = BeamFormerConfig(),
+              PipelineStats* st = nullptr);
     ~BeamFormer();
     
     // Prevent copying
     BeamFormer(const BeamFormer&) = delete;
     BeamFormer& operator=(const BeamFormer&) = delete;
     
+    // Share FFTW plans and steering tables with other instances; set
+    // before init(), the cache must outlive the beamformer
+    void setDspCache(DspCache* cache) { dspCache = cache; }
+    
     bool init();
     bool start();
     void stop();
+    
+    // Run on a WorkerPool thread instead of start(): the ring it waits on,
+    // samples per input frame, and one step processing a frame if one is
+    // queued. False once the input is closed and drained.
+    CircularBuffer* getInputBuffer() const { return inputBuffer; }
+    size_t getInputFrameSamples() const { return (size_t)frameSize * inputChannels; }
+    bool processPending();
+    
     AppState getState() const { return state; }
     void setState(AppState newState) { state = newState; }
     int getCurrentAngle() const { return currentSteeringAngle; }
+    int getAngleCount() const { return angleCount; }
+    int getBeamCount() const { return beamCount; }
+    int getFftSize() const { return fftSize; }
+
+    // Beamform one interleaved float frame of config.frameSize into a frame
+    // with one interleaved channel per beam. Used by the processing thread
+    // and directly by the fused pipeline. Returns false (and enters
+    // STATE_ERROR) if processing failed.
+    bool processFrame(const float* input, float* output);
+    
+    // Single stages of processFrame() for the microbenchmark, run on the
+    // delay lines and correlations the last frame left; from the thread
+    // that calls processFrame(). steerBeams() renders 'beams' (at most
+    // MAX_BEAMS + 1) mono frames with the engine's delay-and-sum or
+    // steered inverse FFTs, estimateDirection() the DOA search.
+    void steerBeams(const int* angles, float* const* outputs, int beams);
+    int estimateDirection() { return estimateDOA(); }
+    
+    // Recover from a failed frame (STATE_ERROR) in place: clear all state
+    // carried between frames and resume with the next one. Called by the
+    // thread running processFrame(), real-time safe.
+    void restartProcessing();
+    
+    // Processing thread frame buffers owned by the caller, one input frame
+    // (frameSize * input channels) and one output frame (frameSize * beams);
+    // set before start()
+    void setScratch(float* input, float* output) {
+        inScratch = input;
+        outScratch = output;
+    }
+    
+    // Log queued steering changes; call from a non-RT thread
+    void drainEvents();
+    
+    // Runtime control from a single non-RT thread. Requests are queued for
+    // the processing thread and take effect at its next frame; false if the
+    // value is out of range or the queue is full.
+    bool requestSteering(int angle);  // -1 returns to DOA tracking
+    bool requestEngine(BeamformerEngine engine);
+    
+    // Latest snapshot from the processing thread, false before the first
+    bool readStatus(BeamFormerStatus& status);
 };
 
 // Forward class declarations to avoid circular dependencies
 class AudioCapture;
 class AlsaOutput;
 
+// Capture and output device of one mic array
+struct ArrayDevices {
+    std::string input;
+    std::string output;  // ALSA device, unused with RTP output
+    
+    ArrayDevices(const std::string& in, const std::string& out) : input(in), output(out) {}
+};
+
 // Main application class
 class BeamFormerApp {
 private:
-    std::string inputDevice;
-    std::string outputDevice;
-    bool loggingEnabled;  // Added logging control
+    // Capture, beamformer and output of one array. Every array runs the
+    // same configuration on its own devices.
+    struct ArrayPipeline {
+        ArrayDevices devices;
+        std::string rtpDestination;  // Derived from config.rtpDestination, empty for ALSA
+        std::string controlPath;     // Derived from config.controlSocket, empty to disable
+        
+        std::unique_ptr<PipelineStats> stats;
+        std::unique_ptr<CircularBuffer> captureToBeamformer;
+        std::unique_ptr<CircularBuffer> beamformerToOutput;
+        
+        std::unique_ptr<AudioCapture> audioCapture;
+        std::unique_ptr<BeamFormer> beamformer;
+        std::unique_ptr<AlsaOutput> alsaOutput;  // Exactly one of these two is created
+        std::unique_ptr<RtpSink> rtpSink;
+        std::unique_ptr<ControlSocket> controlSocket;
+        
+        // Every buffer the audio threads touch per frame, carved out once
+        // init() knows the negotiated periods
+        std::unique_ptr<RtArena> frameArena;
+        
+        // Fused pipeline frame pair
+        float* fusedInput;
+        float* fusedOutput;
+        
+        explicit ArrayPipeline(const ArrayDevices& dev) : devices(dev), fusedInput(nullptr), fusedOutput(nullptr) {}
+    };
     
-    std::unique_ptr<CircularBuffer> captureToBeamformer;
-    std::unique_ptr<CircularBuffer> beamformerToOutput;
+    std::vector<ArrayDevices> arrayDevices;
+    bool loggingEnabled;  // Added logging control
+    BeamFormerConfig config;
     
-    std::unique_ptr<AudioCapture> audioCapture;
-    std::unique_ptr<BeamFormer> beamformer;
-    std::unique_ptr<AlsaOutput> alsaOutput;
-    std::unique_ptr<ErrorHandler> errorHandler;
+    // Shared by all arrays, declared first so they outlive them
     std::unique_ptr<Logger> logger;
+    std::unique_ptr<ErrorHandler> errorHandler;
+    std::unique_ptr<DspCache> dspCache;
+    
+    std::vector<std::unique_ptr<ArrayPipeline>> arrays;
+    
+    // With several arrays their processing runs on these pinned workers;
+    // a single array keeps its own processing thread
+    std::unique_ptr<WorkerPool> workerPool;
+    
+    bool initArray(ArrayPipeline& array, size_t ringSize);
+    bool startArray(ArrayPipeline& array);
+    void stopArray(ArrayPipeline& array);
+    bool allocateFrameBuffers(ArrayPipeline& array);
+    void startControlSocket(ArrayPipeline& array);
+    std::string arrayLabel(size_t index) const;
     
     std::atomic<bool> running;
     
-    // Signal handler for clean shutdown
+    // Fused pipeline: one thread drives capture, beamformer and output of
+    // the only array
+    std::thread fusedThread;
+    void fusedLoop();
+    
+    // Signal handler for clean shutdown, SIGUSR1 requests a statistics dump
     static void sigHandler(int sig);
+    static std::atomic<bool> statsRequested;
     static BeamFormerApp* instance;
     
 public:
-    BeamFormerApp(const std::string& inputDevice, const std::string& outputDevice, bool enableLogging = DEFAULT_LOGGING);
+    BeamFormerApp(const std::string& inputDevice, const std::string& outputDevice, bool enableLogging = DEFAULT_LOGGING,
+                  const BeamFormerConfig& cfg = BeamFormerConfig());
+    
+    // Up to MAX_ARRAYS arrays in one process, sharing the logger, watchdog,
+    // FFTW plans and the steering tables of identical layouts. Array N > 0
+    // sends RTP to the configured port + 2N and listens for control
+    // commands on the configured path with ".N" appended.
+    BeamFormerApp(const std::vector<ArrayDevices>& devices, bool enableLogging = DEFAULT_LOGGING,
+                  const BeamFormerConfig& cfg = BeamFormerConfig());
     ~BeamFormerApp();
     
     // Prevent copying
@@ -117,11 +439,21 @@ public:
     bool init();
     bool start();
     void stop();
-    void waitForExit();
+    
+    // Run until a signal or failure, or for at most timeoutMs when non-zero
+    void waitForExit(int timeoutMs = 0);
+    
+    // Statistics of the first array, null before init()
+    const PipelineStats* getStats() const { return arrays.empty() ? nullptr : arrays[0]->stats.get(); }
     
     static BeamFormerApp* getInstance() { return instance; }
 };
 
+// Inter-thread ring size in samples: at least config.ringSize and four
+// frames of the capture or beam channels, whichever is wider, rounded up
+// to the power of two CircularBuffer needs
+size_t ringSizeFor(const BeamFormerConfig& config);
+
 // Global signal flag
 extern std::atomic<bool> sig_received;
 
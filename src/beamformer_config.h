@@ -0,0 +1,77 @@
+#ifndef BEAMFORMER_CONFIG_H
+#define BEAMFORMER_CONFIG_H
+
+#include <string>
+#include <vector>
+#include "beamformer_defs.h"
+#include "rt_utils.h"
+#include "array_geometry.h"
+
+// Runtime options shared by the application components
+struct BeamFormerConfig {
+    BeamformerEngine engine;    // Time-domain, overlap-save frequency-domain, MVDR or Q15
+    int frameSize;              // Samples per channel per period, the processing block
+    int periods;                // ALSA buffer size in periods
+    size_t ringSize;            // Samples per inter-thread ring (rounded up to a power of 2)
+    int doaInterval;            // Frames between DOA decisions
+    float doaSmoothing;         // Cross-spectrum smoothing factor (0 = no memory)
+    bool vadEnabled;            // Gate DOA updates on voice activity
+    float vadThresholdDb;       // Voice threshold above the noise floor
+    int vadIdleSeconds;         // Silence before passthrough, 0 to keep beamforming
+    int mvdrInterval;           // Frames between MVDR weight solves
+    float mvdrSmoothing;        // Covariance smoothing factor
+    float mvdrLoading;          // Diagonal loading, fraction of the mean mic power
+    FftPlanMode fftPlanMode;    // FFTW planner effort
+    std::string fftWisdomFile;  // Where tuned plans are cached, empty to disable
+    int statsInterval;          // Seconds between statistics summaries, 0 to disable
+    IoMode ioMode;              // Event-driven or sleep-based waiting
+    PipelineMode pipelineMode;  // Three threads with rings, or one fused thread
+    bool useMmap;               // mmap access to the PCM DMA buffers
+    SampleFormat sampleFormat;  // Device sample format, AUTO prefers S32 and S24 over S16
+    bool lockMemory;            // mlockall() before the audio threads start
+    bool driftCompensation;     // Resample playback to the capture clock (threaded pipeline)
+    ThreadRtConfig captureRt;   // Scheduling of the capture, processing and output threads
+    ThreadRtConfig processRt;
+    ThreadRtConfig outputRt;
+    int workerThreads;          // Processing workers shared by several arrays, 0 for one per CPU
+    bool outputBackpressure;    // Processing thread waits for output space instead of dropping, for finite sources
+    ArrayGeometry geometry;     // Mic positions and capture channel mapping
+    std::vector<int> beamAngles; // Fixed beams output after the tracked beam
+    std::string controlSocket;  // Unix socket for runtime control, empty to disable
+    std::string rtpDestination; // HOST:PORT to send RTP to instead of playing, empty for ALSA
+    int rtpPacketFrames;        // Frames per RTP packet
+    bool rtpAngle;              // Attach the steering angle to each RTP packet
+    
+    BeamFormerConfig() :
+        engine(DEFAULT_ENGINE),
+        frameSize(FRAME_SIZE),
+        periods(DEFAULT_PERIODS),
+        ringSize(BUFFER_SIZE),
+        doaInterval(DEFAULT_DOA_INTERVAL),
+        doaSmoothing(DEFAULT_DOA_SMOOTHING),
+        vadEnabled(true),
+        vadThresholdDb(VAD_THRESHOLD_DB),
+        vadIdleSeconds(DEFAULT_VAD_IDLE_SECONDS),
+        mvdrInterval(DEFAULT_MVDR_INTERVAL),
+        mvdrSmoothing(DEFAULT_MVDR_SMOOTHING),
+        mvdrLoading(DEFAULT_MVDR_LOADING),
+        fftPlanMode(FFT_PLAN_MEASURE),
+        fftWisdomFile(DEFAULT_FFT_WISDOM_FILE),
+        statsInterval(DEFAULT_STATS_INTERVAL),
+        ioMode(IO_MODE_EVENT),
+        pipelineMode(PIPELINE_THREADED),
+        useMmap(false),
+        sampleFormat(SAMPLE_FORMAT_AUTO),
+        lockMemory(false),
+        driftCompensation(true),
+        workerThreads(0),
+        outputBackpressure(false),
+        rtpPacketFrames(RTP_DEFAULT_PACKET_FRAMES),
+        rtpAngle(false) {
+    }
+    
+    // Interleaved output channels, one per beam
+    int beamCount() const { return 1 + (int)beamAngles.size(); }
+};
+
+#endif // BEAMFORMER_CONFIG_H
@@ -4,26 +4,111 @@
 // Configuration Constants
 #define SAMPLE_RATE 32000       // 32kHz sampling rate
 #define BITS_PER_SAMPLE 16
-#define NUM_CHANNELS 2
-#define FRAME_SIZE 512        // Process audio in chunks of 512 samples
-#define BUFFER_SIZE 4096      // Circular buffer size (power of 2)
-#define FFT_SIZE 1024         // FFT size for frequency domain processing
-#define MAX_DOA_ANGLES 181    // 0 to 180 degrees
+#define NUM_CHANNELS 2         // Mics in the default array (--geometry overrides)
+#define MAX_CHANNELS 8         // Most mics in one array
+#define MAX_MIC_PAIRS (MAX_CHANNELS * (MAX_CHANNELS - 1) / 2)
+#define MAX_DEVICE_CHANNELS 16 // Most interleaved capture channels
+#define MAX_BEAMS 8            // Output beams: the tracked beam plus fixed ones
+#define FRAME_SIZE 512        // Default period, audio is processed in chunks of this many samples
+#define MIN_FRAME_SIZE 64     // Smallest period accepted by --period and calibration
+#define MAX_FRAME_SIZE 4096   // Largest period accepted by --period
+#define DEFAULT_PERIODS 8     // ALSA buffer size in periods
+#define BUFFER_SIZE 4096      // Default circular buffer size (power of 2)
+#define MAX_DOA_ANGLES 360    // 0-180 degrees for linear arrays, 0-359 azimuth otherwise
 #define DOA_ANGLE_STEP 1      // 1 degree steps
+#define DEFAULT_DOA_INTERVAL 10 // Frames between DOA decisions
+#define DEFAULT_DOA_SMOOTHING 0.8f // Exponential smoothing of the GCC-PHAT cross-spectrum
 #define MAX_LOG_ENTRIES 1000  // Circular log buffer size
+#define LOG_MAX_ARGS 4        // Numeric arguments per real-time log record
+#define LOG_QUEUE_SIZE 256    // Real-time log records queued per thread (power of 2)
+#define LOG_MAX_THREADS 32    // Threads that can register a real-time log queue
+#define LOG_FLUSH_INTERVAL_MS 20 // Background log writer polling interval
+#define LOG_LINE_SIZE 512     // Longest formatted real-time log line
 
 // Beamformer Parameters
 #define MIC_DISTANCE 0.0585   // Distance between microphones in meters (58.5mm)
 #define SOUND_SPEED 343.0     // Speed of sound in m/s
 #define MAX_STEERING_DELAY 24 // Maximum delay in samples for steering (increased for 32kHz)
+#define FRACTIONAL_DELAY_TAPS 4 // Cubic Lagrange (Farrow) fractional delay interpolator
+#define DELAY_LINE_HISTORY (MAX_STEERING_DELAY + FRACTIONAL_DELAY_TAPS) // Samples kept from previous frame
+#define Q15_DOA_HISTORY (2 * MAX_STEERING_DELAY) // Fixed-point DOA lines, both ends of a pair lag
+
+// Voice activity detection
+#define VAD_THRESHOLD_DB 6.0f     // Frame energy above the noise floor that counts as voice
+#define VAD_MIN_LEVEL_DB -70.0f   // Mean square level (dBFS) below which nothing is voice
+#define VAD_HANGOVER_MS 300       // Voice state held after the last loud frame
+#define VAD_FLOOR_RISE_DB 1.0f    // Noise floor climb per second, it falls to quieter frames at once
+#define DEFAULT_VAD_IDLE_SECONDS 0 // Silence before the low-power passthrough, 0 = never
+
+// Adaptive (MVDR) engine
+#define MAX_COVARIANCE_TERMS (MAX_CHANNELS * (MAX_CHANNELS + 1) / 2) // Upper triangle incl. diagonal
+#define DEFAULT_MVDR_INTERVAL 8      // Frames between weight solves
+#define DEFAULT_MVDR_SMOOTHING 0.95f // Exponential smoothing of the spatial covariance
+#define DEFAULT_MVDR_LOADING 0.01f   // Diagonal loading relative to the mean mic power
 
 // Error recovery constants
 #define MAX_XRUN_RETRIES 5    // Maximum number of xrun recovery attempts
 #define WATCHDOG_TIMEOUT_MS 5000 // Watchdog timeout in milliseconds
+#define RECOVERY_RETRY_MS 20     // Between attempts to restart a failed PCM
+#define RESYNC_PERIODS 2         // Samples a recovering stage keeps queued, in periods
+
+// FFT planning
+#define DEFAULT_FFT_WISDOM_FILE "/var/tmp/beamformer_fftw.wisdom"
+#define FFT_WISDOM_SAVE_MS 50 // Re-save loaded wisdom when planning took this long
+
+// Runtime control socket (--control)
+#define CONTROL_MAX_CLIENTS 4 // Concurrent control connections
+#define CONTROL_MAX_LINE 256  // Longest command line
+#define CONTROL_POLL_MS 100   // Server wakeup to notice shutdown
+
+// Clock-drift compensation between capture and playback
+#define RESAMPLER_TAPS 16        // Polyphase FIR length, a multiple of 4
+#define RESAMPLER_PHASES 128     // Tabulated fractional positions, interpolated between
+#define RESAMPLER_CUTOFF 0.45    // Anti-alias cutoff in cycles per sample of the lower rate
+#define DRIFT_SETTLE_SECONDS 2.0 // Ring fill averaged before it becomes the target
+#define DRIFT_AVERAGE_SECONDS 1.0 // Fill level smoothing
+#define DRIFT_TIME_CONSTANT 10.0 // Seconds, response of the critically damped control loop
+#define DRIFT_MAX_PPM 1000.0     // Largest rate correction
+
+// RTP network output (--rtp), L16 audio in network byte order
+#define RTP_DEFAULT_PACKET_FRAMES (SAMPLE_RATE / 100) // 10 ms per packet
+#define RTP_MAX_BATCH 8               // Packets handed to one sendmmsg() call
+#define RTP_PAYLOAD_TYPE 96           // Dynamic payload type announced out of band
+#define RTP_ANGLE_EXT_ID 1            // One-byte header extension carrying the steering angle
+#define RTP_MAX_PAYLOAD 1440          // Larger payloads fragment on a 1500 byte MTU
+
+// Several arrays in one process (repeated -i/-o), processed by a shared worker pool
+#define MAX_ARRAYS 8      // Capture and output device pairs
+#define POOL_WAIT_MS 100  // Worker wakeup while its inputs are idle, to notice stop()
+
+// Real-time scheduling presets (--rt)
+#define RT_PRIORITY_CAPTURE 80
+#define RT_PRIORITY_PROCESS 75
+#define RT_PRIORITY_OUTPUT 80
+#define RT_STACK_PREFAULT_BYTES (64 * 1024)  // Stack touched by each audio thread at start
+
+// Statistics
+#define LATENCY_BUCKET_US 50  // Histogram resolution
+#define LATENCY_BUCKETS 640   // Covers 0-32 ms, the last bucket collects overflow
+#define DEFAULT_STATS_INTERVAL 60 // Seconds between summary lines (0 = off)
+
+// Latency calibration (--calibrate-latency)
+#define CALIBRATION_SECONDS 10 // Measurement time per period size
+#define CALIBRATION_WARMUP_MS 1000 // Ignored start of each step
+#define CALIBRATION_FAULT_THRESHOLD 1.0 // Faults per 1000 periods still considered stable
 
 // Logging constants
 #define DEFAULT_LOGGING 0     // Default logging state (0 = off, 1 = on)
 
+// Device sample formats, little-endian interleaved. Internally every stage
+// works on float samples with full scale at +/-1.0.
+enum SampleFormat {
+    SAMPLE_FORMAT_AUTO,     // Widest of S32, S24 and S16 the device accepts
+    SAMPLE_FORMAT_S16,
+    SAMPLE_FORMAT_S24,      // 24 bits in the low bytes of a 32-bit word
+    SAMPLE_FORMAT_S32
+};
+
 // Application state enumeration
 enum AppState {
     STATE_INIT,
@@ -33,6 +118,40 @@ enum AppState {
     STATE_TERMINATING
 };
 
+// Beamforming engine
+enum BeamformerEngine {
+    ENGINE_TIME_DOMAIN,
+    ENGINE_FREQUENCY_DOMAIN,
+    ENGINE_MVDR,            // Frequency domain with adaptive MVDR weights
+    ENGINE_FIXED_POINT      // Q15 time domain with a correlation DOA, no FFTs
+};
+
+// Engine without -e, fixed point on builds for boards short of float throughput
+#ifdef FIXED_POINT_DEFAULT
+#define DEFAULT_ENGINE ENGINE_FIXED_POINT
+#else
+#define DEFAULT_ENGINE ENGINE_TIME_DOMAIN
+#endif
+
+// FFTW planner effort
+enum FftPlanMode {
+    FFT_PLAN_ESTIMATE,
+    FFT_PLAN_MEASURE,
+    FFT_PLAN_PATIENT
+};
+
+// How threads wait for ring data and device readiness
+enum IoMode {
+    IO_MODE_EVENT,  // eventfd wakeups and poll() on the PCM descriptors
+    IO_MODE_SLEEP   // Sleep-based polling and blocking PCM calls
+};
+
+// Thread layout of the application
+enum PipelineMode {
+    PIPELINE_THREADED,  // Capture, processing and output threads joined by rings
+    PIPELINE_FUSED      // One thread does capture, beamforming and playback per period
+};
+
 // Error types for recovery
 enum ErrorType {
     ERROR_NONE,
@@ -1,100 +1,312 @@
 #include "circular_buffer.h"
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
-CircularBuffer::CircularBuffer(size_t size) : 
-    readPos(0),
+// Polling interval used by waitForRead()/waitForWrite() without events
+#define RING_POLL_INTERVAL_US 500
+
+CircularBuffer::CircularBuffer(size_t size, bool useEvents) :
     writePos(0),
-    closed(false) {
+    readPos(0),
+    closed(false),
+    writeTimeUs(0),
+    eventDriven(false),
+    dataFd(-1),
+    spaceFd(-1),
+    readerWaiting(false),
+    writerWaiting(false) {
     
     // Ensure buffer size is a power of 2
-    if ((size & (size - 1)) != 0) {
+    if (size == 0 || (size & (size - 1)) != 0) {
         throw std::invalid_argument("Buffer size must be a power of 2");
     }
     
     bufferSize = size;
     bufferMask = size - 1;
     buffer.resize(size);
+    
+    // Fall back to polling if eventfds are unavailable
+    if (useEvents) {
+        dataFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        spaceFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        eventDriven = dataFd >= 0 && spaceFd >= 0;
+    }
 }
 
 CircularBuffer::~CircularBuffer() {
     close();
+    if (dataFd >= 0) ::close(dataFd);
+    if (spaceFd >= 0) ::close(spaceFd);
+}
+
+// The full fences pair with the ones in waitForEvent(): either the waiter
+// sees the new position, or the notifier sees the waiting flag
+void CircularBuffer::notifyReader() {
+    if (!eventDriven) return;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readerWaiting.load(std::memory_order_relaxed)) {
+        eventfd_write(dataFd, 1);
+    }
+}
+
+void CircularBuffer::notifyWriter() {
+    if (!eventDriven) return;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerWaiting.load(std::memory_order_relaxed)) {
+        eventfd_write(spaceFd, 1);
+    }
 }
 
-size_t CircularBuffer::write(const int16_t* data, size_t size) {
+void CircularBuffer::publish(size_t wPos) {
+    writeTimeUs.store(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    writePos.store(wPos, std::memory_order_release);
+    notifyReader();
+}
+
+size_t CircularBuffer::write(const float* data, size_t size) {
     if (closed) return 0;
     
-    std::unique_lock<std::mutex> lock(mutex);
+    // Only the producer modifies writePos, so a relaxed load is sufficient.
+    // The acquire on readPos pairs with the consumer's release in read().
+    size_t wPos = writePos.load(std::memory_order_relaxed);
+    size_t rPos = readPos.load(std::memory_order_acquire);
+    
+    size_t toWrite = std::min(bufferSize - (wPos - rPos), size);
+    if (toWrite == 0) {
+        return 0;
+    }
+    
+    // Copy in at most two spans: up to the end of the buffer, then from the start
+    size_t offset = wPos & bufferMask;
+    size_t firstSpan = std::min(toWrite, bufferSize - offset);
+    memcpy(&buffer[offset], data, firstSpan * sizeof(float));
+    if (toWrite > firstSpan) {
+        memcpy(&buffer[0], data + firstSpan, (toWrite - firstSpan) * sizeof(float));
+    }
     
-    size_t written = 0;
-    while (written < size && !closed) {
-        size_t available = availableWrite();
+    // Publish the samples to the consumer
+    publish(wPos + toWrite);
+    return toWrite;
+}
+
+size_t CircularBuffer::read(float* data, size_t size) {
+    size_t rPos = readPos.load(std::memory_order_relaxed);
+    size_t wPos = writePos.load(std::memory_order_acquire);
+    
+    size_t toRead = std::min(wPos - rPos, size);
+    if (toRead == 0) {
+        return 0;
+    }
+    
+    size_t offset = rPos & bufferMask;
+    size_t firstSpan = std::min(toRead, bufferSize - offset);
+    memcpy(data, &buffer[offset], firstSpan * sizeof(float));
+    if (toRead > firstSpan) {
+        memcpy(data + firstSpan, &buffer[0], (toRead - firstSpan) * sizeof(float));
+    }
+    
+    // Hand the space back to the producer
+    readPos.store(rPos + toRead, std::memory_order_release);
+    notifyWriter();
+    return toRead;
+}
+
+size_t CircularBuffer::acquireWrite(float** data, size_t size) {
+    if (closed) return 0;
+    
+    size_t wPos = writePos.load(std::memory_order_relaxed);
+    size_t rPos = readPos.load(std::memory_order_acquire);
+    
+    size_t offset = wPos & bufferMask;
+    size_t span = std::min(bufferSize - (wPos - rPos), bufferSize - offset);
+    
+    *data = &buffer[offset];
+    return std::min(span, size);
+}
+
+void CircularBuffer::commitWrite(size_t size) {
+    size_t wPos = writePos.load(std::memory_order_relaxed);
+    publish(wPos + size);
+}
+
+size_t CircularBuffer::acquireRead(const float** data, size_t size) {
+    size_t rPos = readPos.load(std::memory_order_relaxed);
+    size_t wPos = writePos.load(std::memory_order_acquire);
+    
+    size_t offset = rPos & bufferMask;
+    size_t span = std::min(wPos - rPos, bufferSize - offset);
+    
+    *data = &buffer[offset];
+    return std::min(span, size);
+}
+
+void CircularBuffer::releaseRead(size_t size) {
+    size_t rPos = readPos.load(std::memory_order_relaxed);
+    readPos.store(rPos + size, std::memory_order_release);
+    notifyWriter();
+}
+
+size_t CircularBuffer::discardTo(size_t keep) {
+    size_t available = availableRead();
+    if (available <= keep) {
+        return 0;
+    }
+    
+    releaseRead(available - keep);
+    return available - keep;
+}
+
+void CircularBuffer::close() {
+    closed = true;
+    
+    // Unstick both sides
+    if (eventDriven) {
+        eventfd_write(dataFd, 1);
+        eventfd_write(spaceFd, 1);
+    }
+}
+
+bool CircularBuffer::waitForEvent(int fd, std::atomic<bool>& waiting, bool forRead, size_t size, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    
+    while (true) {
+        if ((forRead ? availableRead() : availableWrite()) >= size) {
+            return true;
+        }
         
-        if (available == 0) {
-            // Buffer is full, wait for space
-            auto status = notFull.wait_for(lock, std::chrono::milliseconds(100));
-            if (closed) break; // Check closed flag after wait
-            continue;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (closed || remaining <= 0) {
+            return false;
         }
         
-        size_t toWrite = std::min(available, size - written);
-        for (size_t i = 0; i < toWrite; i++) {
-            buffer[(writePos + i) & bufferMask] = data[written + i];
+        // Announce the wait, then re-check so a notification cannot be missed
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        
+        if ((forRead ? availableRead() : availableWrite()) < size && !closed) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            poll(&pfd, 1, (int)remaining);
         }
         
-        writePos = (writePos + toWrite) & bufferMask;
-        written += toWrite;
+        waiting.store(false, std::memory_order_relaxed);
         
-        // Notify readers that data is available
-        notEmpty.notify_one();
+        // Clear the counter, it only says that something changed
+        eventfd_t counter;
+        eventfd_read(fd, &counter);
     }
-    
-    return written;
 }
 
-size_t CircularBuffer::read(int16_t* data, size_t size) {
-    std::unique_lock<std::mutex> lock(mutex);
+bool CircularBuffer::waitForRead(size_t size, int timeoutMs) {
+    if (eventDriven) {
+        return waitForEvent(dataFd, readerWaiting, true, size, timeoutMs);
+    }
     
-    size_t read = 0;
-    while (read < size) {
-        size_t available = availableRead();
-        
-        if (available == 0) {
-            if (closed) break;
-            
-            // Buffer is empty, wait for data
-            auto status = notEmpty.wait_for(lock, std::chrono::milliseconds(100));
-            if (closed) break; // Check closed flag after wait
-            continue;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    
+    while (availableRead() < size) {
+        if (closed || std::chrono::steady_clock::now() >= deadline) {
+            return false;
         }
-        
-        size_t toRead = std::min(available, size - read);
-        for (size_t i = 0; i < toRead; i++) {
-            data[read + i] = buffer[(readPos + i) & bufferMask];
+        std::this_thread::sleep_for(std::chrono::microseconds(RING_POLL_INTERVAL_US));
+    }
+    
+    return true;
+}
+
+bool CircularBuffer::waitForWrite(size_t size, int timeoutMs) {
+    if (eventDriven) {
+        return waitForEvent(spaceFd, writerWaiting, false, size, timeoutMs);
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    
+    while (availableWrite() < size) {
+        if (closed || std::chrono::steady_clock::now() >= deadline) {
+            return false;
         }
-        
-        readPos = (readPos + toRead) & bufferMask;
-        read += toRead;
-        
-        // Notify writers that space is available
-        notFull.notify_one();
+        std::this_thread::sleep_for(std::chrono::microseconds(RING_POLL_INTERVAL_US));
     }
     
-    return read;
+    return true;
 }
 
-void CircularBuffer::close() {
-    std::unique_lock<std::mutex> lock(mutex);
-    closed = true;
-    // Signal both conditions to wake up any waiting threads
-    notEmpty.notify_all();
-    notFull.notify_all();
+static bool anyReadable(CircularBuffer* const* rings, const size_t* sizes, int count) {
+    for (int i = 0; i < count; i++) {
+        if (rings[i]->availableRead() >= sizes[i] || rings[i]->isClosed()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CircularBuffer::waitForAnyRead(CircularBuffer* const* rings, const size_t* sizes, int count, int timeoutMs) {
+    if (count > MAX_WAIT_RINGS) {
+        count = MAX_WAIT_RINGS;
+    }
+    if (anyReadable(rings, sizes, count)) {
+        return true;
+    }
+    
+    bool events = count > 0;
+    for (int i = 0; i < count; i++) {
+        events = events && rings[i]->eventDriven;
+    }
+    
+    if (!events) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!anyReadable(rings, sizes, count)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(RING_POLL_INTERVAL_US));
+        }
+        return true;
+    }
+    
+    // The same handshake as waitForEvent(), announced on every ring at once
+    for (int i = 0; i < count; i++) {
+        rings[i]->readerWaiting.store(true, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    if (!anyReadable(rings, sizes, count)) {
+        struct pollfd fds[MAX_WAIT_RINGS];
+        for (int i = 0; i < count; i++) {
+            fds[i].fd = rings[i]->dataFd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        poll(fds, count, timeoutMs);
+    }
+    
+    for (int i = 0; i < count; i++) {
+        rings[i]->readerWaiting.store(false, std::memory_order_relaxed);
+        eventfd_t counter;
+        eventfd_read(rings[i]->dataFd, &counter);
+    }
+    
+    return anyReadable(rings, sizes, count);
 }
 
-size_t CircularBuffer::availableRead() {
-    return (writePos - readPos) & bufferMask;
+size_t CircularBuffer::availableRead() const {
+    // Load readPos first: writePos only grows, so the difference never underflows
+    size_t rPos = readPos.load(std::memory_order_acquire);
+    size_t wPos = writePos.load(std::memory_order_acquire);
+    return wPos - rPos;
 }
 
-size_t CircularBuffer::availableWrite() {
-    return bufferSize - 1 - availableRead();
-}
\ No newline at end of file
+size_t CircularBuffer::availableWrite() const {
+    return bufferSize - availableRead();
+}
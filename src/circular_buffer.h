@@ -2,39 +2,97 @@
 #define CIRCULAR_BUFFER_H
 
 #include <vector>
-#include <mutex>
-#include <condition_variable>
 #include <atomic>
 #include <cstdint>
+#include <cstddef>
 
+// Lock-free single-producer/single-consumer ring buffer of float samples.
+// write() must only be called from one thread and read() from one other thread.
+// Neither side ever blocks; both return the number of samples actually transferred.
+// In event-driven mode a waiting side sleeps on an eventfd that the other
+// side only signals while someone is actually waiting.
 class CircularBuffer {
 private:
-    std::vector<int16_t> buffer;
-    size_t readPos;
-    size_t writePos;
+    static const size_t CACHE_LINE_SIZE = 64;
+    
+public:
+    static const int MAX_WAIT_RINGS = 16;  // Rings one waitForAnyRead() call can watch
+    
+private:
+    
+    std::vector<float> buffer;
     size_t bufferSize;
     size_t bufferMask;
     
-    std::mutex mutex;
-    std::condition_variable notEmpty;
-    std::condition_variable notFull;
+    // Monotonic positions, masked on access. Each index sits on its own cache
+    // line so the producer and consumer never contend for the same line.
+    char padBefore[CACHE_LINE_SIZE];
+    std::atomic<size_t> writePos;   // Written by producer only
+    char padWrite[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> readPos;    // Written by consumer only
+    char padRead[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    
     std::atomic<bool> closed;
+    std::atomic<uint64_t> writeTimeUs;  // Steady clock of the producer's last publish
+    
+    bool eventDriven;
+    int dataFd;                        // Signalled on new samples while the consumer waits
+    int spaceFd;                       // Signalled on freed space while the producer waits
+    std::atomic<bool> readerWaiting;
+    std::atomic<bool> writerWaiting;
+    
+    void notifyReader();
+    void notifyWriter();
+    void publish(size_t wPos);
+    bool waitForEvent(int fd, std::atomic<bool>& waiting, bool forRead, size_t size, int timeoutMs);
 
 public:
-    explicit CircularBuffer(size_t size);
+    explicit CircularBuffer(size_t size, bool useEvents = true);
     ~CircularBuffer();
     
     // Prevent copying
     CircularBuffer(const CircularBuffer&) = delete;
     CircularBuffer& operator=(const CircularBuffer&) = delete;
     
-    size_t write(const int16_t* data, size_t size);
-    size_t read(int16_t* data, size_t size);
+    size_t write(const float* data, size_t size);
+    size_t read(float* data, size_t size);
     void close();
     
-    size_t availableRead();
-    size_t availableWrite();
+    // Zero-copy access. The returned spans point straight into ring memory and
+    // never wrap, so they may be shorter than requested near the end of the buffer.
+    // Producer: reserve up to 'size' samples, fill them, then commit what was written.
+    size_t acquireWrite(float** data, size_t size);
+    void commitWrite(size_t size);
+    
+    // Consumer: peek up to 'size' readable samples, then release them once consumed.
+    size_t acquireRead(const float** data, size_t size);
+    void releaseRead(size_t size);
+    
+    // Consumer: drop the oldest samples so at most 'keep' stay queued, to
+    // bound latency after a stall. Returns the number dropped. 'keep' should
+    // be a multiple of the frame size to preserve channel interleaving.
+    size_t discardTo(size_t keep);
+    
+    // Wait until at least 'size' samples can be read (or written), the buffer
+    // is closed or the timeout expires. Returns true if the samples or space
+    // are available. Sleeps on an eventfd, or polls when events are disabled.
+    bool waitForRead(size_t size, int timeoutMs);
+    bool waitForWrite(size_t size, int timeoutMs);
+    
+    // waitForRead() for a consumer of several rings: until ring i has
+    // sizes[i] samples or is closed, for any i < count (at most
+    // MAX_WAIT_RINGS). Returns false on timeout.
+    static bool waitForAnyRead(CircularBuffer* const* rings, const size_t* sizes, int count, int timeoutMs);
+    
+    // When samples were last published, on the PipelineStats::nowUs() clock.
+    // A consumer can interpolate the fill between the producer's bursts.
+    uint64_t lastWriteUs() const { return writeTimeUs.load(std::memory_order_relaxed); }
+    
+    size_t availableRead() const;
+    size_t availableWrite() const;
+    size_t capacity() const { return bufferSize; }
     bool isClosed() const { return closed; }
+    bool isEventDriven() const { return eventDriven; }
 };
 
-#endif // CIRCULAR_BUFFER_H
\ No newline at end of file
+#endif // CIRCULAR_BUFFER_H
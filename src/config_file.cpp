@@ -0,0 +1,99 @@
+#include "config_file.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(start, end - start + 1);
+}
+
+bool loadConfigFile(const std::string& path, std::vector<std::string>& args, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Cannot open config file: " + path;
+        return false;
+    }
+    
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        size_t eq = line.find('=');
+        std::string key = trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+        
+        if (key.empty() || key.find_first_of(" \t") != std::string::npos) {
+            error = path + ":" + std::to_string(lineNumber) + ": malformed line";
+            return false;
+        }
+        
+        // --config splices the file in, so one naming a file would never end
+        if (key == "config") {
+            error = path + ":" + std::to_string(lineNumber) + ": config files cannot include other config files";
+            return false;
+        }
+        
+        if (value == "false") {
+            continue;
+        }
+        
+        args.push_back("--" + key);
+        if (!value.empty() && value != "true") {
+            args.push_back(value);
+        }
+    }
+    
+    return true;
+}
+
+bool parseIntList(const std::string& text, std::vector<int>& values) {
+    std::istringstream in(text);
+    std::string item;
+    std::vector<int> parsed;
+    while (std::getline(in, item, ',')) {
+        item = trim(item);
+        char* end = nullptr;
+        long value = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0') {
+            return false;
+        }
+        parsed.push_back((int)value);
+    }
+    
+    values = parsed;
+    return true;
+}
+
+bool parseEngine(const std::string& name, BeamformerEngine& engine) {
+    if (name == "time") {
+        engine = ENGINE_TIME_DOMAIN;
+    } else if (name == "freq") {
+        engine = ENGINE_FREQUENCY_DOMAIN;
+    } else if (name == "mvdr") {
+        engine = ENGINE_MVDR;
+    } else if (name == "q15") {
+        engine = ENGINE_FIXED_POINT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* engineName(BeamformerEngine engine) {
+    switch (engine) {
+        case ENGINE_FREQUENCY_DOMAIN: return "freq";
+        case ENGINE_MVDR: return "mvdr";
+        case ENGINE_FIXED_POINT: return "q15";
+        default: return "time";
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef CONFIG_FILE_H
+#define CONFIG_FILE_H
+
+#include <string>
+#include <vector>
+#include "beamformer_defs.h"
+
+// Read a key=value configuration file and append the equivalent command
+// line options to 'args': "key = value" becomes "--key value", a bare key
+// or "key = true" becomes "--key" and "key = false" is dropped. Blank lines
+// and lines starting with '#' are ignored. Returns false with 'error' set
+// when the file cannot be read, a line is malformed or sets "config".
+bool loadConfigFile(const std::string& path, std::vector<std::string>& args, std::string& error);
+
+// Parse a comma-separated list of integers such as "0,90,180". Returns
+// false if any element is not a number.
+bool parseIntList(const std::string& text, std::vector<int>& values);
+
+// Engine names used by --engine and the control socket: time, freq, mvdr or q15
+bool parseEngine(const std::string& name, BeamformerEngine& engine);
+const char* engineName(BeamformerEngine engine);
+
+#endif // CONFIG_FILE_H
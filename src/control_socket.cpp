@@ -0,0 +1,259 @@
+#include "control_socket.h"
+#include "beamformer.h"
+#include "config_file.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static const char* HELP_TEXT =
+    "steer ANGLE     Fix the tracked beam on ANGLE degrees\n"
+    "steer auto      Follow the DOA estimate again\n"
+    "engine time|freq|mvdr|q15  Switch the beamformer engine\n"
+    "log on|off      Toggle logging\n"
+    "status          Current angle, DOA estimate, steering mode, engine and voice activity\n"
+    "scores          DOA score of every angle on the grid\n"
+    "stats           Latency and fault report\n";
+
+ControlSocket::ControlSocket(const std::string& socketPath, BeamFormer* bf, Logger* log, const PipelineStats* st) :
+    path(socketPath),
+    beamformer(bf),
+    logger(log),
+    stats(st),
+    listenFd(-1),
+    running(false) {
+}
+
+ControlSocket::~ControlSocket() {
+    stop();
+}
+
+bool ControlSocket::start() {
+    if (running) {
+        return true;
+    }
+    
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        logger->log(LOG_ERR, "Invalid control socket path: " + path);
+        return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        logger->log(LOG_ERR, "Cannot create control socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    // A previous instance that did not shut down cleanly leaves the file behind
+    unlink(path.c_str());
+    
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, CONTROL_MAX_CLIENTS) < 0) {
+        logger->log(LOG_ERR, "Cannot listen on control socket " + path + ": " + std::string(strerror(errno)));
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    
+    running = true;
+    serverThread = std::thread(&ControlSocket::serverLoop, this);
+    
+    logger->log(LOG_INFO, "Control socket listening on " + path);
+    return true;
+}
+
+void ControlSocket::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    if (serverThread.joinable()) {
+        serverThread.join();
+    }
+    
+    for (size_t i = 0; i < clients.size(); i++) {
+        close(clients[i].fd);
+    }
+    clients.clear();
+    
+    close(listenFd);
+    listenFd = -1;
+    unlink(path.c_str());
+    
+    logger->log(LOG_INFO, "Control socket closed");
+}
+
+void ControlSocket::serverLoop() {
+    std::vector<struct pollfd> fds;
+    
+    while (running) {
+        fds.clear();
+        struct pollfd listener = { listenFd, POLLIN, 0 };
+        fds.push_back(listener);
+        for (size_t i = 0; i < clients.size(); i++) {
+            struct pollfd client = { clients[i].fd, POLLIN, 0 };
+            fds.push_back(client);
+        }
+        
+        // Time out regularly to notice stop()
+        if (poll(fds.data(), fds.size(), CONTROL_POLL_MS) <= 0) {
+            continue;
+        }
+        
+        // Serve existing clients first, fds[i + 1] belongs to clients[i]
+        for (size_t i = clients.size(); i-- > 0;) {
+            if (fds[i + 1].revents && !serviceClient(clients[i])) {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            if (clients.size() >= CONTROL_MAX_CLIENTS) {
+                logger->log(LOG_WARNING, "Control socket busy, refusing client");
+                close(fd);
+                continue;
+            }
+            
+            Client client;
+            client.fd = fd;
+            clients.push_back(client);
+        }
+    }
+}
+
+bool ControlSocket::serviceClient(Client& client) {
+    char buffer[CONTROL_MAX_LINE];
+    ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (received < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    if (received == 0) {
+        return false;  // Client closed
+    }
+    
+    client.pending.append(buffer, received);
+    
+    size_t newline;
+    while ((newline = client.pending.find('\n')) != std::string::npos) {
+        std::string line = client.pending.substr(0, newline);
+        client.pending.erase(0, newline + 1);
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        
+        // Replies are small, a client that cannot take one is dropped
+        std::string reply = handleCommand(line) + "\n";
+        if (send(client.fd, reply.data(), reply.size(), MSG_NOSIGNAL) != (ssize_t)reply.size()) {
+            return false;
+        }
+    }
+    
+    if (client.pending.size() > CONTROL_MAX_LINE) {
+        logger->log(LOG_WARNING, "Control command too long, dropping client");
+        return false;
+    }
+    return true;
+}
+
+std::string ControlSocket::handleCommand(const std::string& line) {
+    std::istringstream in(line);
+    std::string command, value;
+    in >> command >> value;
+    
+    if (command == "steer") {
+        int angle = -1;
+        if (value != "auto") {
+            char* end = nullptr;
+            long parsed = strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || parsed < 0 || parsed >= beamformer->getAngleCount()) {
+                return "error angle must be auto or 0-" + std::to_string(beamformer->getAngleCount() - 1);
+            }
+            angle = (int)parsed;
+        }
+        if (!beamformer->requestSteering(angle)) {
+            return "error command queue full";
+        }
+        logger->log(LOG_INFO, "Control: steer " + value);
+        return "ok";
+    }
+    
+    if (command == "engine") {
+        BeamformerEngine engine;
+        if (!parseEngine(value, engine)) {
+            return "error engine must be time, freq, mvdr or q15";
+        }
+        if (!beamformer->requestEngine(engine)) {
+            return "error command queue full";
+        }
+        logger->log(LOG_INFO, "Control: engine " + value);
+        return "ok";
+    }
+    
+    if (command == "log") {
+        if (value != "on" && value != "off") {
+            return "error log must be on or off";
+        }
+        logger->setLoggingEnabled(value == "on");
+        return "ok";
+    }
+    
+    if (command == "status" || command == "scores") {
+        BeamFormerStatus status;
+        if (!beamformer->readStatus(status)) {
+            return "error no status yet";
+        }
+        
+        std::string reply = "ok";
+        if (command == "status") {
+            reply += " angle " + std::to_string(beamformer->getCurrentAngle());
+            reply += " doa " + (status.doaAngle >= 0 ? std::to_string(status.doaAngle) : std::string("-"));
+            reply += " steering " + (status.fixedAngle >= 0 ? std::to_string(status.fixedAngle) : std::string("auto"));
+            reply += std::string(" engine ") + engineName(status.engine);
+            reply += " beams " + std::to_string(beamformer->getBeamCount());
+            reply += std::string(" voice ") + (status.voiceActive ? "yes" : "no");
+            reply += std::string(" idle ") + (status.passthrough ? "yes" : "no");
+            
+            char levels[64];
+            snprintf(levels, sizeof(levels), " level %.1f floor %.1f", status.levelDb, status.noiseFloorDb);
+            reply += levels;
+        } else {
+            char score[32];
+            for (int angle = 0; angle < status.angleCount; angle++) {
+                snprintf(score, sizeof(score), " %.4f", status.doaScores[angle]);
+                reply += score;
+            }
+        }
+        return reply;
+    }
+    
+    if (command == "stats") {
+        if (!stats) {
+            return "error no statistics";
+        }
+        return stats->report() + "ok";
+    }
+    
+    if (command == "help") {
+        return std::string(HELP_TEXT) + "ok";
+    }
+    
+    return "error unknown command " + command + ", try help";
+}
@@ -0,0 +1,52 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "logger.h"
+#include "pipeline_stats.h"
+
+class BeamFormer;
+
+// Unix-domain stream socket for runtime control. Clients send one command
+// per line and get a reply ending in a line that starts with "ok" or
+// "error"; "help" lists the commands. Served by its own non-RT thread,
+// changes reach the processing thread through the beamformer's lock-free
+// command queue.
+class ControlSocket {
+private:
+    std::string path;
+    BeamFormer* beamformer;
+    Logger* logger;
+    const PipelineStats* stats;  // Optional, may be null
+    
+    int listenFd;
+    std::thread serverThread;
+    std::atomic<bool> running;
+    
+    struct Client {
+        int fd;
+        std::string pending;  // Received text not yet ending in a newline
+    };
+    std::vector<Client> clients;
+    
+    void serverLoop();
+    bool serviceClient(Client& client);
+    std::string handleCommand(const std::string& line);
+
+public:
+    ControlSocket(const std::string& socketPath, BeamFormer* bf, Logger* log, const PipelineStats* st = nullptr);
+    ~ControlSocket();
+    
+    // Prevent copying
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+    
+    // Bind (replacing a stale socket file) and start serving
+    bool start();
+    void stop();
+};
+
+#endif // CONTROL_SOCKET_H
@@ -0,0 +1,177 @@
+#include "drift_resampler.h"
+#include "simd_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+static_assert(RESAMPLER_TAPS % 4 == 0, "Resampler taps must fill whole vectors");
+
+// Zeroth-order modified Bessel function for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+DriftResampler::DriftResampler(int chans, size_t maxOutput, double nominalRatio) :
+    channels(chans),
+    maxInput((size_t)ceil(maxOutput * nominalRatio * (1.0 + DRIFT_MAX_PPM * 1e-6)) + 1),
+    nominal(nominalRatio),
+    ratio(nominalRatio),
+    position(0.0),
+    useNeon(simdEnabled()),
+    table((RESAMPLER_PHASES + 1) * RESAMPLER_TAPS),
+    planeStride(RESAMPLER_TAPS + maxInput) {
+    
+    // Kaiser-windowed sinc, band-limited to the lower of the two rates. Tap
+    // k of phase p sits k - (TAPS/2 - 1) - p/PHASES frames from the output.
+    const double beta = 6.0;
+    const double half = RESAMPLER_TAPS / 2.0;
+    const double cutoff = RESAMPLER_CUTOFF * std::min(1.0, 1.0 / nominalRatio);
+    for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+        float* row = &table[p * RESAMPLER_TAPS];
+        double sum = 0.0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            double t = k - (half - 1.0) - (double)p / RESAMPLER_PHASES;
+            double x = 2.0 * cutoff * t;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double edge = std::max(0.0, 1.0 - (t / half) * (t / half));
+            row[k] = (float)(sinc * besselI0(beta * sqrt(edge)) / besselI0(beta));
+            sum += row[k];
+        }
+        
+        // Unity gain at DC for every phase
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+    
+    planes.assign(planeStride * channels, 0.0f);
+    for (int c = 0; c < channels; c++) {
+        lines.push_back(&planes[c * planeStride]);
+        current.push_back(lines[c] + RESAMPLER_TAPS);
+    }
+}
+
+void DriftResampler::setCorrection(double correction) {
+    double limit = DRIFT_MAX_PPM * 1e-6;
+    ratio = nominal * (1.0 + std::max(-limit, std::min(limit, correction)));
+}
+
+size_t DriftResampler::inputFrames(size_t outFrames) const {
+    return (size_t)(position + outFrames * ratio);
+}
+
+void DriftResampler::reset() {
+    std::fill(planes.begin(), planes.end(), 0.0f);
+    position = 0.0;
+}
+
+void DriftResampler::process(const float* input, size_t inFrames, float* output, size_t outFrames) {
+    // New input goes after the history
+    simdDeinterleave(input, current.data(), channels, inFrames);
+    
+    float coeffs[RESAMPLER_TAPS];
+    for (size_t n = 0; n < outFrames; n++) {
+        double pos = position + n * ratio;
+        size_t base = (size_t)pos;
+        float phase = (float)(pos - base) * RESAMPLER_PHASES;
+        int row = std::min((int)phase, RESAMPLER_PHASES - 1);
+        float blend = phase - row;
+        const float* h0 = &table[row * RESAMPLER_TAPS];
+        const float* h1 = h0 + RESAMPLER_TAPS;
+
+#ifdef __ARM_NEON
+        if (useNeon) {
+            float32x4_t h[RESAMPLER_TAPS / 4];
+            for (int k = 0; k < RESAMPLER_TAPS / 4; k++) {
+                float32x4_t a = vld1q_f32(h0 + k * 4);
+                h[k] = vmlaq_n_f32(a, vsubq_f32(vld1q_f32(h1 + k * 4), a), blend);
+            }
+            for (int c = 0; c < channels; c++) {
+                const float* x = lines[c] + base;
+                float32x4_t acc = vmulq_f32(h[0], vld1q_f32(x));
+                for (int k = 1; k < RESAMPLER_TAPS / 4; k++) {
+                    acc = vmlaq_f32(acc, h[k], vld1q_f32(x + k * 4));
+                }
+#if defined(__aarch64__)
+                output[n * channels + c] = vaddvq_f32(acc);
+#else
+                float32x2_t s = vpadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+                output[n * channels + c] = vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+            }
+            continue;
+        }
+#endif
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            coeffs[k] = h0[k] + blend * (h1[k] - h0[k]);
+        }
+        for (int c = 0; c < channels; c++) {
+            const float* x = lines[c] + base;
+            float sum = 0.0f;
+            for (int k = 0; k < RESAMPLER_TAPS; k++) {
+                sum += coeffs[k] * x[k];
+            }
+            output[n * channels + c] = sum;
+        }
+    }
+    
+    // Carry the newest frames over as history for the next block
+    position += outFrames * ratio - inFrames;
+    for (int c = 0; c < channels; c++) {
+        memmove(lines[c], lines[c] + inFrames, RESAMPLER_TAPS * sizeof(float));
+    }
+}
+
+DriftEstimator::DriftEstimator(size_t periodFrames, unsigned int deviceRate, unsigned int sourceRate) :
+    dt((double)periodFrames / deviceRate),
+    alpha(std::min(1.0, dt / DRIFT_AVERAGE_SECONDS)),
+    // The fill moves at sourceRate times the rate error, critically damped
+    // with the time constant DRIFT_TIME_CONSTANT
+    kp(1.0 / (sourceRate * DRIFT_TIME_CONSTANT)),
+    ki(1.0 / (4.0 * sourceRate * DRIFT_TIME_CONSTANT * DRIFT_TIME_CONSTANT)),
+    settleUpdates((long)(DRIFT_SETTLE_SECONDS / dt)),
+    updates(0),
+    fill(0.0),
+    target(0.0),
+    integral(0.0),
+    correction(0.0) {
+}
+
+void DriftEstimator::retarget() {
+    updates = 0;
+}
+
+double DriftEstimator::update(double fillFrames) {
+    fill = updates == 0 ? fillFrames : fill + alpha * (fillFrames - fill);
+    
+    // Hold the last correction while the target is learnt
+    if (++updates <= settleUpdates) {
+        if (updates == settleUpdates) {
+            target = fill;
+            integral = correction / ki;
+        }
+        return correction;
+    }
+    
+    double error = fill - target;
+    double limit = DRIFT_MAX_PPM * 1e-6;
+    double next = integral + error * dt;
+    double proposed = kp * error + ki * next;
+    
+    // No integration while saturated, so it recovers without windup
+    if (fabs(proposed) < limit) {
+        integral = next;
+    }
+    correction = std::max(-limit, std::min(limit, kp * error + ki * integral));
+    return correction;
+}
@@ -0,0 +1,83 @@
+#ifndef DRIFT_RESAMPLER_H
+#define DRIFT_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+#include "beamformer_defs.h"
+
+// Variable-ratio polyphase resampler for interleaved frames. Every output
+// frame is a RESAMPLER_TAPS windowed-sinc FIR over the input with its phase
+// interpolated between RESAMPLER_PHASES tabulated ones, so the ratio may
+// change between blocks without a discontinuity. Delays by about
+// RESAMPLER_TAPS / 2 input frames.
+class DriftResampler {
+private:
+    int channels;
+    size_t maxInput;      // Input frames per call at the largest ratio
+    double nominal;       // Source rate over device rate
+    double ratio;         // Input frames per output frame
+    double position;      // Next output frame within the history, in input frames
+    bool useNeon;
+    
+    // (RESAMPLER_PHASES + 1) rows of RESAMPLER_TAPS, the last row repeats
+    // phase 0 one input frame later so blending never reads past the table
+    std::vector<float> table;
+    
+    // One plane per channel: RESAMPLER_TAPS frames of history followed by
+    // the current input block
+    std::vector<float> planes;
+    size_t planeStride;
+    std::vector<float*> lines;    // Plane starts
+    std::vector<float*> current;  // Where each plane's input block goes
+
+public:
+    // 'nominalRatio' is source over device rate; the ratio then stays
+    // within DRIFT_MAX_PPM of it
+    DriftResampler(int channels, size_t maxOutput, double nominalRatio);
+    
+    void setCorrection(double correction);  // Relative, e.g. 1e-4 consumes 100 ppm faster
+    double getRatio() const { return ratio; }
+    size_t maxInputFrames() const { return maxInput; }
+    
+    // Input frames the next process() call of 'outFrames' consumes
+    size_t inputFrames(size_t outFrames) const;
+    
+    // Consume exactly inputFrames(outFrames) frames and produce 'outFrames'
+    void process(const float* input, size_t inFrames, float* output, size_t outFrames);
+    
+    void reset();
+};
+
+// Estimates clock drift from the fill level of the ring feeding playback.
+// The level is averaged, after DRIFT_SETTLE_SECONDS the average becomes the
+// target, and a critically damped PI loop returns the rate correction that
+// holds it there. Positive when the fill grows and input must be consumed
+// faster.
+class DriftEstimator {
+private:
+    double dt;           // Seconds between updates
+    double alpha;        // Fill smoothing per update
+    double kp;
+    double ki;
+    long settleUpdates;
+    long updates;
+    double fill;         // Smoothed, in frames
+    double target;
+    double integral;
+    double correction;
+
+public:
+    // One update per device period of 'periodFrames' at 'deviceRate';
+    // 'sourceRate' sets the loop gain
+    DriftEstimator(size_t periodFrames, unsigned int deviceRate, unsigned int sourceRate);
+    
+    // Feed the ring fill in frames, returns the correction to apply
+    double update(double fillFrames);
+    double getCorrection() const { return correction; }
+    
+    // Learn a new target, e.g. after the ring was resynced; the drift
+    // estimate itself is kept
+    void retarget();
+};
+
+#endif // DRIFT_RESAMPLER_H
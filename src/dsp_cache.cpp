@@ -0,0 +1,69 @@
+#include "dsp_cache.h"
+
+DspCache::~DspCache() {
+    for (size_t i = 0; i < plans.size(); i++) {
+        fftwf_destroy_plan(plans[i].plan);
+    }
+}
+
+fftwf_plan DspCache::findPlan(int fftSize, unsigned flags, bool forward) {
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (plans[i].fftSize == fftSize && plans[i].flags == flags && plans[i].forward == forward) {
+            return plans[i].plan;
+        }
+    }
+    
+    // Planned on scratch buffers so MEASURE/PATIENT never scribble over
+    // live data. fftwf_malloc aligns every buffer alike, which new-array
+    // execution requires.
+    const int fftBins = fftSize / 2 + 1;
+    float* real = (float*)fftwf_malloc(sizeof(float) * fftSize);
+    fftwf_complex* complex = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftBins);
+    fftwf_plan plan = nullptr;
+    if (real && complex) {
+        plan = forward ? fftwf_plan_dft_r2c_1d(fftSize, real, complex, flags)
+                       : fftwf_plan_dft_c2r_1d(fftSize, complex, real, flags);
+    }
+    if (real) fftwf_free(real);
+    if (complex) fftwf_free(complex);
+    
+    if (plan) {
+        Plan entry;
+        entry.fftSize = fftSize;
+        entry.flags = flags;
+        entry.forward = forward;
+        entry.plan = plan;
+        plans.push_back(entry);
+    }
+    return plan;
+}
+
+static bool sameLayout(const std::vector<MicPosition>& a, const std::vector<MicPosition>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t m = 0; m < a.size(); m++) {
+        if (a[m].x != b[m].x || a[m].y != b[m].y || a[m].z != b[m].z) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const SteeringTables> DspCache::findSteering(const ArrayGeometry& geometry, int fftSize) const {
+    // The channel map only reorders the input, the steering follows the mics
+    for (size_t i = 0; i < steering.size(); i++) {
+        if (steering[i].fftSize == fftSize && sameLayout(steering[i].mics, geometry.mics)) {
+            return steering[i].tables;
+        }
+    }
+    return nullptr;
+}
+
+void DspCache::addSteering(const ArrayGeometry& geometry, int fftSize, std::shared_ptr<const SteeringTables> tables) {
+    Steering entry;
+    entry.mics = geometry.mics;
+    entry.fftSize = fftSize;
+    entry.tables = tables;
+    steering.push_back(entry);
+}
@@ -0,0 +1,82 @@
+#ifndef DSP_CACHE_H
+#define DSP_CACHE_H
+
+#include <fftw3.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "beamformer_defs.h"
+#include "array_geometry.h"
+
+// Time-domain steering of one mic: whole sample delay and fractional delay
+// taps, float and rounded to Q15
+struct DelayTaps {
+    int whole;
+    float weights[FRACTIONAL_DELAY_TAPS];
+    int16_t weightsQ15[FRACTIONAL_DELAY_TAPS];
+};
+
+// Steering of every angle on an array's grid, read-only once built:
+// delayTaps [angle][channel], frequency-domain weights [angle][channel][bin]
+struct SteeringTables {
+    std::vector<DelayTaps> delayTaps;
+    fftwf_complex* weights;
+    
+    SteeringTables() : weights(nullptr) {}
+    ~SteeringTables() {
+        if (weights) fftwf_free(weights);
+    }
+    
+    // Prevent copying
+    SteeringTables(const SteeringTables&) = delete;
+    SteeringTables& operator=(const SteeringTables&) = delete;
+};
+
+// FFTW plans and steering tables shared by the beamformers of a process.
+// A plan depends only on the FFT size and planner flags; each instance runs
+// it on its own buffers with the new-array execute functions. Steering
+// tables are shared by arrays of the same layout and FFT size. FFTW
+// planning is not thread-safe, so use the cache from one thread, before
+// the audio threads start.
+class DspCache {
+private:
+    struct Plan {
+        int fftSize;
+        unsigned flags;
+        bool forward;
+        fftwf_plan plan;
+    };
+    
+    struct Steering {
+        std::vector<MicPosition> mics;
+        int fftSize;
+        std::shared_ptr<const SteeringTables> tables;
+    };
+    
+    std::vector<Plan> plans;
+    std::vector<Steering> steering;
+    
+    fftwf_plan findPlan(int fftSize, unsigned flags, bool forward);
+
+public:
+    DspCache() {}
+    ~DspCache();
+    
+    // Prevent copying
+    DspCache(const DspCache&) = delete;
+    DspCache& operator=(const DspCache&) = delete;
+    
+    // Out-of-place real-to-complex and complex-to-real plans of fftSize,
+    // created on first use. nullptr if FFTW cannot plan the size.
+    fftwf_plan forwardPlan(int fftSize, unsigned flags) { return findPlan(fftSize, flags, true); }
+    fftwf_plan backwardPlan(int fftSize, unsigned flags) { return findPlan(fftSize, flags, false); }
+    
+    // Tables built for this mic layout and FFT size, nullptr if none yet
+    std::shared_ptr<const SteeringTables> findSteering(const ArrayGeometry& geometry, int fftSize) const;
+    void addSteering(const ArrayGeometry& geometry, int fftSize, std::shared_ptr<const SteeringTables> tables);
+    
+    int planCount() const { return (int)plans.size(); }
+    int steeringCount() const { return (int)steering.size(); }
+};
+
+#endif // DSP_CACHE_H
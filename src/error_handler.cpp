@@ -13,42 +13,40 @@ ErrorHandler::~ErrorHandler() {
     stopWatchdog();
 }
 
-void ErrorHandler::reportError(ErrorType err, const std::string& details) {
-    std::lock_guard<std::mutex> lock(errorMutex);
-    
+void ErrorHandler::reportError(ErrorType err, const char* details) {
     lastError = err;
     
+    const char* kind;
     switch (err) {
         case ERROR_ALSA_XRUN:
-            logger->log(LOG_ERR, "ALSA xrun error: " + details);
+            kind = "ALSA xrun";
             break;
         case ERROR_ALSA_SUSPEND:
-            logger->log(LOG_ERR, "ALSA suspend error: " + details);
+            kind = "ALSA suspend";
             break;
         case ERROR_PROCESSING:
-            logger->log(LOG_ERR, "Processing error: " + details);
+            kind = "Processing";
             break;
         case ERROR_SYSTEM:
-            logger->log(LOG_ERR, "System error: " + details);
+            kind = "System";
             break;
         default:
-            logger->log(LOG_ERR, "Unknown error: " + details);
+            kind = "Unknown";
             break;
     }
+    logger->logf(LOG_ERR, "%s error: %s", kind, details);
     
     // Set global state to error
     setGlobalState(STATE_ERROR);
     
     // Attempt to recover automatically
     if (recoverFromError()) {
-        logger->log(LOG_INFO, "Recovered from error");
+        logger->logf(LOG_INFO, "Recovered from error");
         setGlobalState(STATE_RUNNING);
     }
 }
 
 bool ErrorHandler::recoverFromError() {
-    std::lock_guard<std::mutex> lock(errorMutex);
-    
     bool recovered = false;
     
     // Set state to recovery
@@ -64,8 +62,8 @@ bool ErrorHandler::recoverFromError() {
             recovered = true;
             break;
         case ERROR_PROCESSING:
-            // Processing errors may require restarting the processing thread
-            recovered = false;
+            // The processing thread resets its state at the next frame
+            recovered = true;
             break;
         case ERROR_SYSTEM:
             // System errors may require more complex recovery
@@ -86,7 +84,7 @@ bool ErrorHandler::recoverFromError() {
 
 void ErrorHandler::setGlobalState(AppState state) {
     globalState = state;
-    logger->log(LOG_INFO, "Global state changed to: " + std::to_string(state));
+    logger->logf(LOG_INFO, "Global state changed to: %d", (int)state);
 }
 
 AppState ErrorHandler::getGlobalState() const {
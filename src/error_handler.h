@@ -2,7 +2,6 @@
 #define ERROR_HANDLER_H
 
 #include <atomic>
-#include <mutex>
 #include <thread>
 #include "beamformer_defs.h"
 #include "logger.h"
@@ -11,7 +10,6 @@ class ErrorHandler {
 private:
     std::atomic<AppState> globalState;
     std::atomic<ErrorType> lastError;
-    std::mutex errorMutex;
     Logger* logger;
     
     // Watchdog related
@@ -29,7 +27,9 @@ public:
     ErrorHandler(const ErrorHandler&) = delete;
     ErrorHandler& operator=(const ErrorHandler&) = delete;
     
-    void reportError(ErrorType err, const std::string& details);
+    // Safe to call from the RT threads: no locks and no allocation, so
+    // 'details' must outlive the log writer (a literal or snd_strerror())
+    void reportError(ErrorType err, const char* details);
     bool recoverFromError();
     void setGlobalState(AppState state);
     AppState getGlobalState() const;
@@ -0,0 +1,417 @@
+#include "file_io.h"
+#include "sample_convert.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+// Longest single wait for ring space or data, end of stream wakes earlier
+#define FILE_IO_WAIT_MS 100
+
+// WAV fields are little-endian, as is every target this runs on
+static uint32_t readLe32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readLe16(const unsigned char* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void writeLe32(unsigned char* p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static void writeLe16(unsigned char* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+// Decode a WAV data chunk: PCM format 1 at 16/24/32 bits or IEEE float (3) at 32 bits
+static bool decodeSamples(const std::vector<unsigned char>& raw, uint16_t audioFormat, unsigned int bits,
+                          std::vector<float>& samples) {
+    size_t bytes = bits / 8;
+    size_t count = raw.size() / bytes;
+    samples.resize(count);
+    
+    if (audioFormat == 3 && bits == 32) {
+        memcpy(samples.data(), raw.data(), count * sizeof(float));
+    } else if (audioFormat == 1 && bits == 16) {
+        convertToFloat(SAMPLE_FORMAT_S16, raw.data(), samples.data(), count);
+    } else if (audioFormat == 1 && bits == 32) {
+        convertToFloat(SAMPLE_FORMAT_S32, raw.data(), samples.data(), count);
+    } else if (audioFormat == 1 && bits == 24) {
+        // Packed 3-byte samples, widened into the top of an int32
+        for (size_t i = 0; i < count; i++) {
+            const unsigned char* p = &raw[i * 3];
+            int32_t v = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+            samples[i] = v / 2147483648.0f;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool loadAudioFile(const std::string& path, std::vector<float>& samples,
+                   AudioFileFormat& format, Logger* logger, unsigned int rawChannels) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        logger->log(LOG_ERR, "Cannot open audio file: " + path);
+        return false;
+    }
+    
+    unsigned char header[12];
+    size_t headerRead = fread(header, 1, sizeof(header), file);
+    
+    if (headerRead < sizeof(header) || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        // No RIFF header, treat the whole file as raw interleaved samples
+        format.channels = rawChannels;
+        format.sampleRate = SAMPLE_RATE;
+        format.bitsPerSample = 16;
+        
+        fseek(file, 0, SEEK_END);
+        long bytes = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        
+        std::vector<int16_t> raw(bytes / sizeof(int16_t));
+        size_t got = fread(raw.data(), sizeof(int16_t), raw.size(), file);
+        samples.resize(got);
+        convertToFloat(SAMPLE_FORMAT_S16, raw.data(), samples.data(), got);
+        fclose(file);
+        
+        // Whole frames only, a partial one would shift the interleave on every repeat
+        if (rawChannels > 0) {
+            samples.resize(samples.size() - samples.size() % rawChannels);
+        }
+        
+        logger->log(LOG_INFO, "Loaded raw audio file " + path + " (" + std::to_string(samples.size()) + " samples)");
+        return true;
+    }
+    
+    // Walk the chunks for "fmt " and "data", skipping anything else
+    bool haveFormat = false;
+    uint16_t audioFormat = 0;
+    unsigned char chunk[8];
+    
+    while (fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+        uint32_t chunkSize = readLe32(chunk + 4);
+        
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[40];
+            size_t want = std::min((size_t)chunkSize, sizeof(fmt));
+            if (chunkSize < 16 || fread(fmt, 1, want, file) != want) {
+                break;
+            }
+            
+            // PCM or float, or WAVE_FORMAT_EXTENSIBLE with either as sub-format
+            audioFormat = readLe16(fmt);
+            if (audioFormat == 0xFFFE && want >= 26) {
+                audioFormat = readLe16(fmt + 24);
+            }
+            
+            format.channels = readLe16(fmt + 2);
+            format.sampleRate = readLe32(fmt + 4);
+            format.bitsPerSample = readLe16(fmt + 14);
+            
+            bool pcm = audioFormat == 1 && (format.bitsPerSample == 16 || format.bitsPerSample == 24 ||
+                                            format.bitsPerSample == 32);
+            bool ieeeFloat = audioFormat == 3 && format.bitsPerSample == 32;
+            if (!pcm && !ieeeFloat) {
+                logger->log(LOG_ERR, "Unsupported WAV encoding in " + path + ", expected 16/24/32-bit PCM or float");
+                fclose(file);
+                return false;
+            }
+            
+            haveFormat = true;
+            fseek(file, (long)(chunkSize - want + (chunkSize & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                break;
+            }
+            
+            std::vector<unsigned char> raw(chunkSize);
+            raw.resize(fread(raw.data(), 1, raw.size(), file));
+            fclose(file);
+            
+            if (!decodeSamples(raw, audioFormat, format.bitsPerSample, samples)) {
+                logger->log(LOG_ERR, "Cannot decode samples in " + path);
+                return false;
+            }
+            samples.resize(samples.size() - samples.size() % format.channels);
+            
+            logger->log(LOG_INFO, "Loaded WAV file " + path + " (" + std::to_string(samples.size() / format.channels) +
+                        " frames, " + std::to_string(format.channels) + " channels, " +
+                        std::to_string(format.bitsPerSample) + " bits, " +
+                        std::to_string(format.sampleRate) + " Hz)");
+            return true;
+        } else {
+            // Chunks are padded to an even size
+            fseek(file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR);
+        }
+    }
+    
+    logger->log(LOG_ERR, "Malformed WAV file: " + path);
+    fclose(file);
+    return false;
+}
+
+// WavWriter implementation
+WavWriter::WavWriter() :
+    file(nullptr),
+    channels(0),
+    sampleRate(0),
+    dataBytes(0) {
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::writeHeader() {
+    unsigned char header[44];
+    uint16_t blockAlign = channels * sizeof(int16_t);
+    
+    memcpy(header, "RIFF", 4);
+    writeLe32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    writeLe32(header + 16, 16);
+    writeLe16(header + 20, 1);  // PCM
+    writeLe16(header + 22, channels);
+    writeLe32(header + 24, sampleRate);
+    writeLe32(header + 28, sampleRate * blockAlign);
+    writeLe16(header + 32, blockAlign);
+    writeLe16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    writeLe32(header + 40, dataBytes);
+    
+    return fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool WavWriter::open(const std::string& path, unsigned int chans, unsigned int rate) {
+    close();
+    
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    
+    channels = chans;
+    sampleRate = rate;
+    dataBytes = 0;
+    return writeHeader();
+}
+
+bool WavWriter::write(const float* data, size_t frames) {
+    if (!file) return false;
+    
+    // Convert through a small stack buffer, a whole frame at a time
+    int16_t pcm[1024];
+    const size_t chunkFrames = sizeof(pcm) / sizeof(pcm[0]) / channels;
+    size_t done = 0;
+    
+    while (done < frames) {
+        size_t n = std::min(chunkFrames, frames - done);
+        convertFromFloat(SAMPLE_FORMAT_S16, data + done * channels, pcm, n * channels);
+        
+        size_t written = fwrite(pcm, sizeof(int16_t) * channels, n, file);
+        dataBytes += written * sizeof(int16_t) * channels;
+        done += written;
+        if (written < n) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WavWriter::close() {
+    if (!file) return true;
+    
+    bool ok = writeHeader();
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+// FileSource implementation
+FileSource::FileSource(const std::string& filePath, CircularBuffer* outBuf, Logger* log, int loopCount,
+                       unsigned int chans) :
+    path(filePath),
+    outputBuffer(outBuf),
+    logger(log),
+    loops(std::max(1, loopCount)),
+    channels(chans),
+    running(false),
+    finished(false) {
+    format.channels = 0;
+    format.sampleRate = 0;
+    format.bitsPerSample = 0;
+}
+
+FileSource::~FileSource() {
+    stop();
+}
+
+bool FileSource::init() {
+    // Preload so file I/O never shows up in the measurements
+    if (!loadAudioFile(path, samples, format, logger, channels)) {
+        return false;
+    }
+    
+    if (format.channels != channels) {
+        logger->log(LOG_ERR, "Input has " + std::to_string(format.channels) + " channels, expected " +
+                    std::to_string(channels));
+        return false;
+    }
+    
+    if (format.sampleRate != SAMPLE_RATE) {
+        logger->log(LOG_WARNING, "Input sample rate " + std::to_string(format.sampleRate) +
+                    " Hz differs from " + std::to_string(SAMPLE_RATE) + " Hz, steering will be off");
+    }
+    
+    return true;
+}
+
+bool FileSource::start() {
+    if (running) {
+        return true;
+    }
+    
+    running = true;
+    finished = false;
+    sourceThread = std::thread(&FileSource::sourceLoop, this);
+    return true;
+}
+
+void FileSource::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    if (sourceThread.joinable()) {
+        sourceThread.join();
+    }
+}
+
+void FileSource::sourceLoop() {
+    for (int loop = 0; loop < loops && running; loop++) {
+        size_t offset = 0;
+        
+        while (offset < samples.size() && running) {
+            // Copy straight into ring memory
+            float* dest = nullptr;
+            size_t span = outputBuffer->acquireWrite(&dest, samples.size() - offset);
+            
+            if (span == 0) {
+                if (outputBuffer->isClosed()) {
+                    running = false;
+                    break;
+                }
+                outputBuffer->waitForWrite(1, FILE_IO_WAIT_MS);
+                continue;
+            }
+            
+            memcpy(dest, samples.data() + offset, span * sizeof(float));
+            outputBuffer->commitWrite(span);
+            offset += span;
+        }
+    }
+    
+    // End of stream, the consumer drains what is left and stops
+    outputBuffer->close();
+    finished = true;
+}
+
+// FileSink implementation
+FileSink::FileSink(const std::string& filePath, CircularBuffer* inBuf, Logger* log, unsigned int chans) :
+    path(filePath),
+    inputBuffer(inBuf),
+    logger(log),
+    channels(chans),
+    running(false),
+    finished(false),
+    framesWritten(0) {
+}
+
+FileSink::~FileSink() {
+    stop();
+}
+
+bool FileSink::init() {
+    if (path.empty()) {
+        return true;
+    }
+    
+    if (!writer.open(path, channels, SAMPLE_RATE)) {
+        logger->log(LOG_ERR, "Cannot create output file: " + path);
+        return false;
+    }
+    
+    return true;
+}
+
+bool FileSink::start() {
+    if (running) {
+        return true;
+    }
+    
+    running = true;
+    finished = false;
+    sinkThread = std::thread(&FileSink::sinkLoop, this);
+    return true;
+}
+
+void FileSink::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    if (sinkThread.joinable()) {
+        sinkThread.join();
+    }
+    
+    if (writer.isOpen() && !writer.close()) {
+        logger->log(LOG_ERR, "Failed to finalize output file: " + path);
+    }
+}
+
+void FileSink::sinkLoop() {
+    std::vector<float> frame(channels);
+    
+    while (running) {
+        const float* data = nullptr;
+        size_t span = inputBuffer->acquireRead(&data, inputBuffer->capacity());
+        span -= span % channels;
+        
+        if (span == 0) {
+            // Nothing buffered, or a frame straddling the end of the ring
+            if (inputBuffer->availableRead() >= channels) {
+                inputBuffer->read(frame.data(), channels);
+                if (writer.isOpen()) {
+                    writer.write(frame.data(), 1);
+                }
+                framesWritten++;
+                continue;
+            }
+            if (inputBuffer->isClosed()) {
+                break;
+            }
+            inputBuffer->waitForRead(channels, FILE_IO_WAIT_MS);
+            continue;
+        }
+        
+        if (writer.isOpen()) {
+            writer.write(data, span / channels);
+        }
+        inputBuffer->releaseRead(span);
+        framesWritten += span / channels;
+    }
+    
+    finished = true;
+}
@@ -0,0 +1,123 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "beamformer_defs.h"
+#include "circular_buffer.h"
+#include "logger.h"
+
+// Layout of interleaved audio
+struct AudioFileFormat {
+    unsigned int channels;
+    unsigned int sampleRate;
+    unsigned int bitsPerSample;
+};
+
+// Load a 16, 24 or 32-bit PCM or 32-bit float WAV file, or raw interleaved
+// S16_LE samples at rawChannels/SAMPLE_RATE when the file has no RIFF
+// header. Samples are returned as float with full scale at +/-1.0.
+bool loadAudioFile(const std::string& path, std::vector<float>& samples,
+                   AudioFileFormat& format, Logger* logger, unsigned int rawChannels = NUM_CHANNELS);
+
+// Streaming 16-bit PCM WAV writer taking float samples, sizes are patched
+// in on close()
+class WavWriter {
+private:
+    FILE* file;
+    unsigned int channels;
+    unsigned int sampleRate;
+    uint32_t dataBytes;
+    
+    bool writeHeader();
+
+public:
+    WavWriter();
+    ~WavWriter();
+    
+    // Prevent copying
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+    
+    bool open(const std::string& path, unsigned int chans, unsigned int rate);
+    bool write(const float* data, size_t frames);
+    bool close();
+    bool isOpen() const { return file != nullptr; }
+};
+
+// Feeds a preloaded audio file into a CircularBuffer as fast as the
+// consumer allows, then closes the buffer to signal end of stream
+class FileSource {
+private:
+    std::string path;
+    CircularBuffer* outputBuffer;
+    Logger* logger;
+    int loops;
+    unsigned int channels;  // Interleaved channels the file must have
+    
+    std::vector<float> samples;
+    AudioFileFormat format;
+    
+    std::thread sourceThread;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+    
+    void sourceLoop();
+
+public:
+    FileSource(const std::string& filePath, CircularBuffer* outBuf, Logger* log, int loopCount = 1,
+               unsigned int chans = NUM_CHANNELS);
+    ~FileSource();
+    
+    // Prevent copying
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+    
+    bool init();
+    bool start();
+    void stop();
+    bool isFinished() const { return finished; }
+    
+    // Frames per channel that will be delivered over all loops
+    size_t totalFrames() const { return samples.size() / channels * loops; }
+    const AudioFileFormat& getFormat() const { return format; }
+    const std::vector<float>& getSamples() const { return samples; }
+};
+
+// Drains an interleaved CircularBuffer until it is closed and empty,
+// optionally writing the samples to a WAV file
+class FileSink {
+private:
+    std::string path;  // Empty to discard the output
+    CircularBuffer* inputBuffer;
+    Logger* logger;
+    unsigned int channels;
+    WavWriter writer;
+    
+    std::thread sinkThread;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+    std::atomic<size_t> framesWritten;
+    
+    void sinkLoop();
+
+public:
+    FileSink(const std::string& filePath, CircularBuffer* inBuf, Logger* log, unsigned int chans = 1);
+    ~FileSink();
+    
+    // Prevent copying
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    
+    bool init();
+    bool start();
+    void stop();
+    bool isFinished() const { return finished; }
+    size_t getFramesWritten() const { return framesWritten; }  // Frames of all channels
+};
+
+#endif // FILE_IO_H
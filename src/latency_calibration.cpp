@@ -0,0 +1,92 @@
+#include "latency_calibration.h"
+#include "beamformer.h"
+#include <cstdio>
+#include <algorithm>
+
+// Counters that mark a period as late or lost
+static uint32_t faultCount(const PipelineStats* stats) {
+    return stats->xruns.load() + stats->deadlineMisses.load();
+}
+
+static CalibrationStep runStep(const std::string& inputDevice, const std::string& outputDevice, bool loggingEnabled,
+                               const BeamFormerConfig& config, const CalibrationOptions& options) {
+    CalibrationStep step;
+    step.frameSize = config.frameSize;
+    step.started = false;
+    step.periods = 0;
+    step.faults = 0;
+    step.processP99Us = 0;
+    step.stable = false;
+    
+    BeamFormerApp app(inputDevice, outputDevice, loggingEnabled, config);
+    if (!app.init() || !app.start()) {
+        return step;
+    }
+    step.started = true;
+    
+    // Start-up xruns while the devices fill are not a property of the period
+    app.waitForExit(CALIBRATION_WARMUP_MS);
+    const PipelineStats* stats = app.getStats();
+    uint32_t startFaults = faultCount(stats);
+    uint32_t startPeriods = stats->latency[STAGE_PROCESS].summarize().count;
+    
+    app.waitForExit(options.seconds * 1000);
+    
+    LatencyHistogram::Summary process = stats->latency[STAGE_PROCESS].summarize();
+    step.periods = process.count - startPeriods;
+    step.faults = faultCount(stats) - startFaults;
+    step.processP99Us = process.p99Us;
+    step.stable = step.periods > 0 && step.faults * 1000.0 / step.periods <= options.threshold;
+    
+    app.stop();
+    return step;
+}
+
+int calibrateLatency(const std::string& inputDevice, const std::string& outputDevice, bool loggingEnabled,
+                     const BeamFormerConfig& config, const CalibrationOptions& options,
+                     std::vector<CalibrationStep>* steps) {
+    BeamFormerConfig stepConfig = config;
+    int best = 0;
+    
+    printf("Calibrating from %d frames, %d s per step, up to %.2f faults per 1000 periods\n",
+           config.frameSize, options.seconds, options.threshold);
+    printf("%8s %8s %8s %8s %8s  %s\n", "period", "ms", "periods", "faults", "p99 us", "result");
+    
+    while (!sig_received) {
+        CalibrationStep step = runStep(inputDevice, outputDevice, loggingEnabled, stepConfig, options);
+        if (steps) {
+            steps->push_back(step);
+        }
+        
+        // A signal cuts the step short, its numbers say nothing
+        if (sig_received) {
+            break;
+        }
+        
+        printf("%8d %8.2f %8u %8u %8u  %s\n", step.frameSize, step.frameSize * 1000.0 / SAMPLE_RATE,
+               step.periods, step.faults, step.processP99Us,
+               !step.started ? "unsupported" : step.stable ? "stable" : "unstable");
+        fflush(stdout);
+        
+        if (!step.stable) {
+            break;
+        }
+        best = step.frameSize;
+        
+        // Shrink by a quarter, keeping periods a multiple of 16 frames
+        int next = std::max(MIN_FRAME_SIZE, stepConfig.frameSize * 3 / 4 / 16 * 16);
+        if (next >= stepConfig.frameSize) {
+            break;
+        }
+        stepConfig.frameSize = next;
+    }
+    
+    if (best > 0) {
+        printf("Smallest stable period: %d frames (%.2f ms), use --period %d --periods %d\n",
+               best, best * 1000.0 / SAMPLE_RATE, best, config.periods);
+    } else {
+        printf("No stable period found at or below %d frames\n", config.frameSize);
+    }
+    
+    return best;
+}
@@ -0,0 +1,37 @@
+#ifndef LATENCY_CALIBRATION_H
+#define LATENCY_CALIBRATION_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "beamformer_config.h"
+
+// Result of running the live pipeline at one period size
+struct CalibrationStep {
+    int frameSize;
+    bool started;          // False when the devices or DSP refused this size
+    uint32_t periods;      // Periods processed after the warm-up
+    uint32_t faults;       // xruns and deadline misses
+    uint32_t processP99Us;
+    bool stable;
+};
+
+struct CalibrationOptions {
+    int seconds;           // Measurement time per step
+    double threshold;      // Faults per 1000 periods still considered stable
+    
+    CalibrationOptions() :
+        seconds(CALIBRATION_SECONDS),
+        threshold(CALIBRATION_FAULT_THRESHOLD) {
+    }
+};
+
+// Run the application at config.frameSize, then at successively smaller
+// periods, until a step is unstable or MIN_FRAME_SIZE is reached. Each step
+// is printed as it completes. Returns the smallest stable frame size, or 0
+// when even the starting size was unstable.
+int calibrateLatency(const std::string& inputDevice, const std::string& outputDevice, bool loggingEnabled,
+                     const BeamFormerConfig& config, const CalibrationOptions& options,
+                     std::vector<CalibrationStep>* steps = nullptr);
+
+#endif // LATENCY_CALIBRATION_H
@@ -1,25 +1,40 @@
 #include "logger.h"
 #include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+// Distinguishes logger instances in the per-thread queue cache
+static std::atomic<unsigned> nextLoggerId(1);
 
 Logger::Logger(bool useSyslog, bool enabled) : 
     logBuffer(MAX_LOG_ENTRIES),
     nextLogIndex(0),
     logToSyslog(useSyslog),
-    loggingEnabled(enabled) {
+    loggingEnabled(enabled),
+    loggerId(nextLoggerId++),
+    threadQueueCount(0),
+    writerRunning(true) {
     
     if (logToSyslog) {
         openlog("beamformer", LOG_PID, LOG_USER);
     }
+    
+    writerThread = std::thread(&Logger::writerLoop, this);
 }
 
 Logger::~Logger() {
+    writerRunning = false;
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    
     if (logToSyslog) {
         closelog();
     }
 }
 
 void Logger::setLoggingEnabled(bool enabled) {
-    std::lock_guard<std::mutex> lock(logMutex);
     loggingEnabled = enabled;
     
     if (loggingEnabled) {
@@ -28,50 +43,182 @@ void Logger::setLoggingEnabled(bool enabled) {
 }
 
 void Logger::log(int level, const std::string& message) {
-    std::lock_guard<std::mutex> lock(logMutex);
-    
     // Skip logging if disabled, except for errors which are always logged
     if (!loggingEnabled && level != LOG_ERR) {
         return;
     }
     
-    // Create log entry
-    LogEntry entry;
-    entry.level = level;
-    entry.message = message;
-    entry.timestamp = time(nullptr);
+    emit(level, message.c_str(), time(nullptr));
+}
+
+void Logger::report(const std::string& message) {
+    emit(LOG_NOTICE, message.c_str(), time(nullptr));
+}
+
+void Logger::emit(int level, const char* message, time_t timestamp) {
+    std::lock_guard<std::mutex> lock(logMutex);
     
     // Store in circular buffer
-    logBuffer[nextLogIndex] = entry;
+    LogEntry& entry = logBuffer[nextLogIndex];
+    entry.level = level;
+    entry.message = message;
+    entry.timestamp = timestamp;
     nextLogIndex = (nextLogIndex + 1) % MAX_LOG_ENTRIES;
     
     // Log to syslog if enabled
     if (logToSyslog) {
-        syslog(level, "%s", message.c_str());
+        syslog(level, "%s", message);
     }
     
     // Also print to stderr for debugging
-    std::string levelStr;
+    const char* levelStr;
     switch (level) {
         case LOG_ERR: levelStr = "ERROR"; break;
         case LOG_WARNING: levelStr = "WARNING"; break;
+        case LOG_NOTICE: levelStr = "NOTICE"; break;
         case LOG_INFO: levelStr = "INFO"; break;
         case LOG_DEBUG: levelStr = "DEBUG"; break;
         default: levelStr = "UNKNOWN"; break;
     }
     
-    fprintf(stderr, "[%s] %s\n", levelStr.c_str(), message.c_str());
+    fprintf(stderr, "[%s] %s\n", levelStr, message);
 }
 
-void Logger::dumpLogs(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(logMutex);
+Logger::ThreadQueue* Logger::threadQueue() {
+    // Cached per thread so only the first call from a thread takes the lock
+    static thread_local unsigned cachedLoggerId = 0;
+    static thread_local ThreadQueue* cachedQueue = nullptr;
+    
+    if (cachedLoggerId == loggerId) {
+        return cachedQueue;
+    }
+    
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    size_t count = threadQueueCount.load(std::memory_order_relaxed);
+    if (count >= LOG_MAX_THREADS) {
+        return nullptr;
+    }
+    
+    threadQueues[count].reset(new ThreadQueue());
+    threadQueueCount.store(count + 1, std::memory_order_release);
+    
+    cachedLoggerId = loggerId;
+    cachedQueue = threadQueues[count].get();
+    return cachedQueue;
+}
+
+void Logger::push(const LogRecord& record) {
+    ThreadQueue* queue = threadQueue();
+    if (queue && !queue->records.push(record)) {
+        queue->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::writerLoop() {
+    while (writerRunning) {
+        drainQueues();
+        std::this_thread::sleep_for(std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+    }
     
+    // Flush whatever the real-time threads queued before shutdown
+    drainQueues();
+}
+
+void Logger::drainQueues() {
+    char line[LOG_LINE_SIZE];
+    size_t count = threadQueueCount.load(std::memory_order_acquire);
+    
+    for (size_t q = 0; q < count; q++) {
+        ThreadQueue* queue = threadQueues[q].get();
+        
+        LogRecord record;
+        while (queue->records.pop(record)) {
+            formatRecord(record, line, sizeof(line));
+            emit(record.level, line, record.timestamp);
+        }
+        
+        unsigned dropped = queue->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            snprintf(line, sizeof(line), "Log queue full, dropped %u records", dropped);
+            emit(LOG_WARNING, line, time(nullptr));
+        }
+    }
+}
+
+void Logger::formatRecord(const LogRecord& record, char* out, size_t size) {
+    // Walk the printf-style format and render each conversion with the
+    // stored argument, widening the length modifier to match its slot type
+    const char* f = record.format;
+    size_t pos = 0;
+    int argIndex = 0;
+    
+    while (*f && pos + 1 < size) {
+        if (*f != '%') {
+            out[pos++] = *f++;
+            continue;
+        }
+        
+        if (f[1] == '%') {
+            out[pos++] = '%';
+            f += 2;
+            continue;
+        }
+        
+        // Copy flags, width and precision, drop any length modifiers
+        char spec[32];
+        size_t specLen = 0;
+        spec[specLen++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && specLen < sizeof(spec) - 4) {
+            spec[specLen++] = *f++;
+        }
+        while (*f && strchr("hlLqjzt", *f)) {
+            f++;
+        }
+        
+        char conv = *f ? *f++ : 's';
+        int written = 0;
+        
+        if (argIndex >= record.argCount) {
+            written = snprintf(out + pos, size - pos, "<?>");
+        } else {
+            const LogArg& arg = record.args[argIndex++];
+            if (strchr("diouxXc", conv)) {
+                spec[specLen++] = 'l';
+                spec[specLen++] = 'l';
+                spec[specLen++] = conv == 'c' ? 'd' : conv;
+                spec[specLen] = '\0';
+                long long value = arg.type == LogArg::DOUBLE ? (long long)arg.d : arg.i;
+                written = snprintf(out + pos, size - pos, spec, value);
+            } else if (strchr("eEfFgGaA", conv)) {
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                double value = arg.type == LogArg::INT ? (double)arg.i : arg.d;
+                written = snprintf(out + pos, size - pos, spec, value);
+            } else {
+                spec[specLen++] = 's';
+                spec[specLen] = '\0';
+                const char* value = arg.type == LogArg::STRING && arg.s ? arg.s : "<?>";
+                written = snprintf(out + pos, size - pos, spec, value);
+            }
+        }
+        
+        if (written > 0) {
+            pos = std::min(size - 1, pos + (size_t)written);
+        }
+    }
+    
+    out[pos] = '\0';
+}
+
+void Logger::dumpLogs(const std::string& filename) {
     FILE* file = fopen(filename.c_str(), "w");
     if (!file) {
         log(LOG_ERR, "Cannot open log file: " + filename);
         return;
     }
     
+    std::lock_guard<std::mutex> lock(logMutex);
+    
     // Dump logs in chronological order
     for (size_t i = 0; i < MAX_LOG_ENTRIES; i++) {
         size_t index = (nextLogIndex + i) % MAX_LOG_ENTRIES;
@@ -114,4 +261,4 @@ std::vector<LogEntry> Logger::getRecentLogs(int count) {
     }
     
     return recent;
-}
\ No newline at end of file
+}
@@ -4,9 +4,13 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
 #include <ctime>
 #include <syslog.h>
 #include "beamformer_defs.h"
+#include "spsc_queue.h"
 
 // Log entry structure
 struct LogEntry {
@@ -15,15 +19,65 @@ struct LogEntry {
     time_t timestamp;
 };
 
+// Numeric or static-string argument of a real-time log record
+struct LogArg {
+    enum Type { INT, DOUBLE, STRING } type;
+    union {
+        long long i;
+        double d;
+        const char* s;  // Must point to static storage (literals, snd_strerror)
+    };
+};
+
+// Fixed-size record pushed by real-time threads. The format string is a
+// printf-style literal that is only referenced, never copied.
+struct LogRecord {
+    int level;
+    int argCount;
+    const char* format;
+    LogArg args[LOG_MAX_ARGS];
+    time_t timestamp;
+};
+
 // Logger class with circular buffer
 class Logger {
 private:
+    // Per-thread record queue, registered the first time a thread calls logf()
+    struct ThreadQueue {
+        SpscQueue<LogRecord, LOG_QUEUE_SIZE> records;
+        std::atomic<unsigned> dropped;
+        ThreadQueue() : dropped(0) {}
+    };
+    
     std::vector<LogEntry> logBuffer;
     size_t nextLogIndex;
     std::mutex logMutex;
     bool logToSyslog;
-    bool loggingEnabled;  // Added flag to control logging
+    std::atomic<bool> loggingEnabled;  // Added flag to control logging
     
+    // Asynchronous backend
+    unsigned loggerId;
+    std::mutex queuesMutex;
+    std::unique_ptr<ThreadQueue> threadQueues[LOG_MAX_THREADS];
+    std::atomic<size_t> threadQueueCount;
+    std::thread writerThread;
+    std::atomic<bool> writerRunning;
+    
+    ThreadQueue* threadQueue();
+    void push(const LogRecord& record);
+    void writerLoop();
+    void drainQueues();
+    void emit(int level, const char* message, time_t timestamp);
+    static void formatRecord(const LogRecord& record, char* out, size_t size);
+    
+    static LogArg makeArg(int value) { LogArg a; a.type = LogArg::INT; a.i = value; return a; }
+    static LogArg makeArg(unsigned value) { LogArg a; a.type = LogArg::INT; a.i = value; return a; }
+    static LogArg makeArg(long value) { LogArg a; a.type = LogArg::INT; a.i = value; return a; }
+    static LogArg makeArg(unsigned long value) { LogArg a; a.type = LogArg::INT; a.i = (long long)value; return a; }
+    static LogArg makeArg(long long value) { LogArg a; a.type = LogArg::INT; a.i = value; return a; }
+    static LogArg makeArg(double value) { LogArg a; a.type = LogArg::DOUBLE; a.d = value; return a; }
+    static LogArg makeArg(const char* value) { LogArg a; a.type = LogArg::STRING; a.s = value; return a; }
+
 public:
     explicit Logger(bool useSyslog = true, bool enabled = DEFAULT_LOGGING);
     ~Logger();
@@ -35,9 +89,44 @@ public:
     void setLoggingEnabled(bool enabled);
     bool isLoggingEnabled() const { return loggingEnabled; }
     
+    // Synchronous logging for init, shutdown and other non-RT paths
     void log(int level, const std::string& message);
+    
+    // Operator-requested output such as statistics, written even when
+    // logging is disabled
+    void report(const std::string& message);
+    
+    // Real-time safe logging: no locks, no allocation, no I/O on the calling
+    // thread. Up to LOG_MAX_ARGS numeric or static string arguments.
+    template <typename... Args>
+    void logf(int level, const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+        
+        // Skip logging if disabled, except for errors which are always logged
+        if (!loggingEnabled && level != LOG_ERR) {
+            return;
+        }
+        
+        LogRecord record;
+        record.level = level;
+        record.format = format;
+        record.argCount = (int)sizeof...(Args);
+        record.timestamp = time(nullptr);
+        
+        LogArg packed[sizeof...(Args) + 1] = { makeArg(args)... };
+        for (int i = 0; i < record.argCount; i++) {
+            record.args[i] = packed[i];
+        }
+        
+        push(record);
+    }
+    
+    // Register the calling thread's queue now; logf() would otherwise
+    // allocate it on the thread's first record. Call before an RT loop.
+    void prepareThread() { threadQueue(); }
+    
     void dumpLogs(const std::string& filename);
     std::vector<LogEntry> getRecentLogs(int count = 50);
 };
 
-#endif // LOGGER_H
\ No newline at end of file
+#endif // LOGGER_H
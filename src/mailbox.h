@@ -0,0 +1,52 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+
+// Lock-free single-writer/single-reader mailbox holding the latest value of
+// a trivially copyable record (triple buffering). The writer fills the
+// slot returned by writeSlot() and publishes it; the reader always gets the
+// newest complete value. Neither side blocks, older values are overwritten.
+template <typename T>
+class Mailbox {
+private:
+    static const unsigned INDEX_MASK = 3;
+    static const unsigned FRESH = 4;  // Middle slot holds a value the reader has not taken
+    
+    T slots[3];
+    unsigned back;                 // Writer only
+    std::atomic<unsigned> middle;  // Slot index plus FRESH, exchanged by both sides
+    unsigned front;                // Reader only
+    bool received;                 // Reader only, something was ever published
+
+public:
+    Mailbox() : slots(), back(0), middle(1), front(2), received(false) {}
+    
+    // Prevent copying
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+    
+    T& writeSlot() {
+        return slots[back];
+    }
+    
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    
+    // Copy the newest value into 'value', false if nothing was published yet
+    bool read(T& value) {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+            received = true;
+        }
+        if (!received) {
+            return false;
+        }
+        
+        value = slots[front];
+        return true;
+    }
+};
+
+#endif // MAILBOX_H
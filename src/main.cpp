@@ -1,43 +1,315 @@
 #include "beamformer.h"
+#include "config_file.h"
+#include "latency_calibration.h"
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <algorithm>
 
 // Main function
 int main(int argc, char* argv[]) {
     // Default values
     std::string inputDevice = "hw:1,0";  // Default ALSA input device for ReSpeaker
     std::string outputDevice = "default"; // Default ALSA output device
+    std::vector<std::string> inputDevices;  // One array per --input, paired with --output in order
+    std::vector<std::string> outputDevices;
     bool loggingEnabled = DEFAULT_LOGGING; // Default logging state
+    BeamFormerConfig config;
+    bool rtPreset = false;
+    bool calibrate = false;
+    CalibrationOptions calibration;
     
-    // Parse command line arguments
-    for (int i = 1; i < argc; i++) {
-        std::string arg = argv[i];
+    // Parse command line arguments, --config splices the file's options in
+    // at its position so options after it override the file
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string arg = args[i];
         
-        if (arg == "-i" || arg == "--input") {
-            if (i + 1 < argc) {
-                inputDevice = argv[++i];
+        if (arg == "--config") {
+            if (i + 1 < args.size()) {
+                std::vector<std::string> fileArgs;
+                std::string error;
+                if (!loadConfigFile(args[i + 1], fileArgs, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+                args.erase(args.begin() + i, args.begin() + i + 2);
+                args.insert(args.begin() + i, fileArgs.begin(), fileArgs.end());
+                i--;
+            }
+        } else if (arg == "-i" || arg == "--input") {
+            if (i + 1 < args.size()) {
+                inputDevices.push_back(args[++i]);
             }
         } else if (arg == "-o" || arg == "--output") {
-            if (i + 1 < argc) {
-                outputDevice = argv[++i];
+            if (i + 1 < args.size()) {
+                outputDevices.push_back(args[++i]);
             }
         } else if (arg == "-l" || arg == "--log") {
-            if (i + 1 < argc) {
-                loggingEnabled = std::stoi(argv[++i]) != 0;
+            if (i + 1 < args.size()) {
+                loggingEnabled = std::stoi(args[++i]) != 0;
+            }
+        } else if (arg == "-d" || arg == "--doa-interval") {
+            if (i + 1 < args.size()) {
+                config.doaInterval = std::max(1, std::stoi(args[++i]));
+            }
+        } else if (arg == "-e" || arg == "--engine") {
+            if (i + 1 < args.size()) {
+                std::string engine = args[++i];
+                if (!parseEngine(engine, config.engine)) {
+                    fprintf(stderr, "Unknown engine: %s\n", engine.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--mvdr-interval") {
+            if (i + 1 < args.size()) {
+                config.mvdrInterval = std::max(1, std::stoi(args[++i]));
+            }
+        } else if (arg == "--mvdr-smoothing") {
+            if (i + 1 < args.size()) {
+                config.mvdrSmoothing = std::min(0.999f, std::max(0.0f, std::stof(args[++i])));
+            }
+        } else if (arg == "--mvdr-loading") {
+            if (i + 1 < args.size()) {
+                config.mvdrLoading = std::max(0.0f, std::stof(args[++i]));
+            }
+        } else if (arg == "--no-vad") {
+            config.vadEnabled = false;
+        } else if (arg == "--vad-threshold") {
+            if (i + 1 < args.size()) {
+                config.vadThresholdDb = std::max(0.0f, std::stof(args[++i]));
+            }
+        } else if (arg == "--vad-idle") {
+            if (i + 1 < args.size()) {
+                config.vadIdleSeconds = std::max(0, std::stoi(args[++i]));
+            }
+        } else if (arg == "--fft-plan") {
+            if (i + 1 < args.size()) {
+                std::string mode = args[++i];
+                if (mode == "estimate") {
+                    config.fftPlanMode = FFT_PLAN_ESTIMATE;
+                } else if (mode == "measure") {
+                    config.fftPlanMode = FFT_PLAN_MEASURE;
+                } else if (mode == "patient") {
+                    config.fftPlanMode = FFT_PLAN_PATIENT;
+                } else {
+                    fprintf(stderr, "Unknown FFT plan mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--fft-wisdom") {
+            if (i + 1 < args.size()) {
+                config.fftWisdomFile = args[++i];
+            }
+        } else if (arg == "--stats-interval") {
+            if (i + 1 < args.size()) {
+                config.statsInterval = std::max(0, std::stoi(args[++i]));
+            }
+        } else if (arg == "--rt") {
+            rtPreset = true;
+        } else if (arg == "--mlock") {
+            config.lockMemory = true;
+        } else if (arg == "--rt-capture" || arg == "--rt-process" || arg == "--rt-output") {
+            if (i + 1 < args.size()) {
+                ThreadRtConfig& rt = arg == "--rt-capture" ? config.captureRt :
+                                     arg == "--rt-process" ? config.processRt : config.outputRt;
+                if (!parseThreadRtConfig(args[++i], rt)) {
+                    fprintf(stderr, "Invalid %s value: %s (expected PRIO, PRIO@CPU or @CPU)\n", arg.c_str(), args[i].c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--workers") {
+            if (i + 1 < args.size()) {
+                config.workerThreads = std::max(0, std::stoi(args[++i]));
+            }
+        } else if (arg == "--io-mode") {
+            if (i + 1 < args.size()) {
+                std::string mode = args[++i];
+                if (mode == "event") {
+                    config.ioMode = IO_MODE_EVENT;
+                } else if (mode == "sleep") {
+                    config.ioMode = IO_MODE_SLEEP;
+                } else {
+                    fprintf(stderr, "Unknown I/O mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--pipeline") {
+            if (i + 1 < args.size()) {
+                std::string mode = args[++i];
+                if (mode == "threaded") {
+                    config.pipelineMode = PIPELINE_THREADED;
+                } else if (mode == "fused") {
+                    config.pipelineMode = PIPELINE_FUSED;
+                } else {
+                    fprintf(stderr, "Unknown pipeline mode: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--mmap") {
+            config.useMmap = true;
+        } else if (arg == "--no-drift") {
+            config.driftCompensation = false;
+        } else if (arg == "--format") {
+            if (i + 1 < args.size()) {
+                std::string format = args[++i];
+                if (format == "auto") {
+                    config.sampleFormat = SAMPLE_FORMAT_AUTO;
+                } else if (format == "s16") {
+                    config.sampleFormat = SAMPLE_FORMAT_S16;
+                } else if (format == "s24") {
+                    config.sampleFormat = SAMPLE_FORMAT_S24;
+                } else if (format == "s32") {
+                    config.sampleFormat = SAMPLE_FORMAT_S32;
+                } else {
+                    fprintf(stderr, "Unknown sample format: %s\n", format.c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--period") {
+            if (i + 1 < args.size()) {
+                config.frameSize = std::stoi(args[++i]);
+            }
+        } else if (arg == "--periods") {
+            if (i + 1 < args.size()) {
+                config.periods = std::max(2, std::stoi(args[++i]));
+            }
+        } else if (arg == "--ring-size") {
+            if (i + 1 < args.size()) {
+                config.ringSize = (size_t)std::max(1, std::stoi(args[++i]));
+            }
+        } else if (arg == "--calibrate-latency") {
+            calibrate = true;
+        } else if (arg == "--calibrate-seconds") {
+            if (i + 1 < args.size()) {
+                calibration.seconds = std::max(1, std::stoi(args[++i]));
+            }
+        } else if (arg == "--calibrate-threshold") {
+            if (i + 1 < args.size()) {
+                calibration.threshold = std::max(0.0, std::stod(args[++i]));
+            }
+        } else if (arg == "--beams") {
+            if (i + 1 < args.size()) {
+                if (!parseIntList(args[++i], config.beamAngles)) {
+                    fprintf(stderr, "Invalid --beams value: %s (expected angles like 0,90,180)\n", args[i].c_str());
+                    return 1;
+                }
+            }
+        } else if (arg == "--control") {
+            if (i + 1 < args.size()) {
+                config.controlSocket = args[++i];
+            }
+        } else if (arg == "--rtp") {
+            if (i + 1 < args.size()) {
+                config.rtpDestination = args[++i];
+            }
+        } else if (arg == "--rtp-packet") {
+            if (i + 1 < args.size()) {
+                config.rtpPacketFrames = std::max(1, std::stoi(args[++i]));
+            }
+        } else if (arg == "--rtp-angle") {
+            config.rtpAngle = true;
+        } else if (arg == "--geometry") {
+            if (i + 1 < args.size()) {
+                std::string error;
+                if (!loadArrayGeometry(args[++i], config.geometry, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
             }
         } else if (arg == "-h" || arg == "--help") {
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
-            printf("  -i, --input DEVICE    ALSA input device to use (default: hw:1,0)\n");
-            printf("  -o, --output DEVICE   ALSA output device to use (default: default)\n");
+            printf("  -i, --input DEVICE    ALSA input device to use (default: hw:1,0), repeat for up to %d arrays\n",
+                   MAX_ARRAYS);
+            printf("  -o, --output DEVICE   ALSA output device to use (default: default), one per --input\n");
             printf("  -l, --log VALUE       Enable logging (0=off, 1=on, default: %d)\n", DEFAULT_LOGGING);
+            printf("  -d, --doa-interval N  Frames between DOA estimates (default: %d)\n", DEFAULT_DOA_INTERVAL);
+            printf("  -e, --engine TYPE     Beamformer engine: time, freq, mvdr or q15 (default: %s)\n",
+                   engineName(DEFAULT_ENGINE));
+            printf("  --mvdr-interval N     Frames between MVDR weight solves (default: %d)\n", DEFAULT_MVDR_INTERVAL);
+            printf("  --mvdr-smoothing X    MVDR covariance smoothing, 0-0.999 (default: %.2f)\n", DEFAULT_MVDR_SMOOTHING);
+            printf("  --mvdr-loading X      MVDR diagonal loading, fraction of mic power (default: %.2f)\n",
+                   DEFAULT_MVDR_LOADING);
+            printf("  --no-vad              Update DOA on every frame, not only while voice is active\n");
+            printf("  --vad-threshold DB    Voice level over the noise floor (default: %.1f)\n", VAD_THRESHOLD_DB);
+            printf("  --vad-idle SECONDS    Silence before a low-power unsteered passthrough, 0 = never (default: %d)\n",
+                   DEFAULT_VAD_IDLE_SECONDS);
+            printf("  --fft-plan MODE       FFTW planning: estimate, measure or patient (default: measure)\n");
+            printf("  --fft-wisdom FILE     FFTW wisdom cache, empty to disable (default: %s)\n", DEFAULT_FFT_WISDOM_FILE);
+            printf("  --stats-interval N    Seconds between latency summaries, 0 to disable (default: %d)\n", DEFAULT_STATS_INTERVAL);
+            printf("  Send SIGUSR1 for a full latency and fault report\n");
+            printf("  --rt                  SCHED_FIFO audio threads (capture %d, process %d, output %d) and --mlock\n",
+                   RT_PRIORITY_CAPTURE, RT_PRIORITY_PROCESS, RT_PRIORITY_OUTPUT);
+            printf("  --rt-capture SPEC     Capture thread PRIO, PRIO@CPU or @CPU (also --rt-process, --rt-output)\n");
+            printf("  --mlock               Lock process memory to avoid page faults\n");
+            printf("  --workers N           Pinned processing threads shared by several arrays (default: one per CPU)\n");
+            printf("  --io-mode MODE        Wait on events or sleep-poll: event or sleep (default: event)\n");
+            printf("  --pipeline MODE       threaded (3 threads) or fused (1 thread) (default: threaded)\n");
+            printf("  --mmap                Use mmap access to the PCM buffers when the device supports it\n");
+            printf("  --no-drift            Play at the output clock without following the capture clock\n");
+            printf("  --format FMT          Device sample format: auto, s16, s24 or s32 (default: auto, widest supported)\n");
+            printf("  --period N            Frames per period and processing block, %d-%d (default: %d)\n",
+                   MIN_FRAME_SIZE, MAX_FRAME_SIZE, FRAME_SIZE);
+            printf("  --periods N           ALSA buffer size in periods (default: %d)\n", DEFAULT_PERIODS);
+            printf("  --ring-size N         Samples per inter-thread ring, rounded up to a power of 2 (default: %d)\n", BUFFER_SIZE);
+            printf("  --calibrate-latency   Step the period down from --period and report the smallest stable one\n");
+            printf("  --calibrate-seconds N Measurement time per step (default: %d)\n", CALIBRATION_SECONDS);
+            printf("  --calibrate-threshold X  Faults per 1000 periods still stable (default: %.1f)\n",
+                   CALIBRATION_FAULT_THRESHOLD);
+            printf("  --geometry FILE       Microphone array description (default: %d mics %.1f mm apart)\n",
+                   NUM_CHANNELS, MIC_DISTANCE * 1000);
+            printf("  --beams A,B,...       Also output fixed beams at these angles, one channel each after the tracked beam\n");
+            printf("  --control PATH        Unix socket for runtime steering, engine, logging and stats commands\n");
+            printf("  --rtp HOST:PORT       Send the beams as L16 RTP (payload type %d) instead of playing them\n",
+                   RTP_PAYLOAD_TYPE);
+            printf("  --rtp-packet N        Frames per RTP packet (default: %d)\n", RTP_DEFAULT_PACKET_FRAMES);
+            printf("  --rtp-angle           Attach the steering angle to each RTP packet as header extension %d\n",
+                   RTP_ANGLE_EXT_ID);
+            printf("  --config FILE         Read key=value options, e.g. period = 256 or mmap = true\n");
             printf("  -h, --help            Show this help message\n");
             return 0;
         }
     }
     
+    // Checked after parsing so a later option can override a config file
+    if (config.frameSize < MIN_FRAME_SIZE || config.frameSize > MAX_FRAME_SIZE) {
+        fprintf(stderr, "Period must be %d-%d frames\n", MIN_FRAME_SIZE, MAX_FRAME_SIZE);
+        return 1;
+    }
+    
+    // The preset fills in priorities that were not given explicitly
+    if (rtPreset) {
+        if (config.captureRt.priority == 0) config.captureRt.priority = RT_PRIORITY_CAPTURE;
+        if (config.processRt.priority == 0) config.processRt.priority = RT_PRIORITY_PROCESS;
+        if (config.outputRt.priority == 0) config.outputRt.priority = RT_PRIORITY_OUTPUT;
+        config.lockMemory = true;
+    }
+    
+    // Each array plays on its own device, RTP output derives a port per array
+    if (inputDevices.size() > 1 && config.rtpDestination.empty() && outputDevices.size() != inputDevices.size()) {
+        fprintf(stderr, "Give one --output for each of the %zu --input devices\n", inputDevices.size());
+        return 1;
+    }
+    if (!inputDevices.empty()) inputDevice = inputDevices[0];
+    if (!outputDevices.empty()) outputDevice = outputDevices[0];
+    
+    std::vector<ArrayDevices> arrays;
+    for (size_t a = 0; a < std::max((size_t)1, inputDevices.size()); a++) {
+        arrays.push_back(ArrayDevices(a < inputDevices.size() ? inputDevices[a] : inputDevice,
+                                      a < outputDevices.size() ? outputDevices[a] : outputDevice));
+    }
+    
+    if (calibrate) {
+        if (arrays.size() > 1) {
+            fprintf(stderr, "Latency calibration runs on a single array\n");
+            return 1;
+        }
+        return calibrateLatency(inputDevice, outputDevice, loggingEnabled, config, calibration) > 0 ? 0 : 1;
+    }
+    
     // Create and initialize application
-    BeamFormerApp app(inputDevice, outputDevice, loggingEnabled);
+    BeamFormerApp app(arrays, loggingEnabled, config);
     
     if (!app.init()) {
         fprintf(stderr, "Failed to initialize application\n");
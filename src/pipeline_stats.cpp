@@ -0,0 +1,107 @@
+#include "pipeline_stats.h"
+#include <cstdio>
+
+static const char* stageNames[STAGE_COUNT] = { "capture", "process", "output" };
+
+LatencyHistogram::LatencyHistogram() :
+    count(0),
+    maxUs(0) {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    Summary summary;
+    summary.count = count.load(std::memory_order_relaxed);
+    summary.maxUs = maxUs.load(std::memory_order_relaxed);
+    summary.p50Us = 0;
+    summary.p99Us = 0;
+    
+    if (summary.count == 0) {
+        return summary;
+    }
+    
+    // Percentiles are reported as the upper edge of the bucket they fall in,
+    // the overflow bucket has no upper edge so it reports the exact maximum
+    uint64_t p50Target = (summary.count + 1) / 2;
+    uint64_t p99Target = ((uint64_t)summary.count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    bool havePercentile50 = false;
+    
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (!havePercentile50 && seen >= p50Target) {
+            summary.p50Us = (i == LATENCY_BUCKETS - 1) ? summary.maxUs : (i + 1) * LATENCY_BUCKET_US;
+            havePercentile50 = true;
+        }
+        if (seen >= p99Target) {
+            summary.p99Us = (i == LATENCY_BUCKETS - 1) ? summary.maxUs : (i + 1) * LATENCY_BUCKET_US;
+            break;
+        }
+    }
+    
+    // Never report a bucket edge above the largest sample seen
+    if (summary.p50Us > summary.maxUs) summary.p50Us = summary.maxUs;
+    if (summary.p99Us > summary.maxUs) summary.p99Us = summary.maxUs;
+    
+    return summary;
+}
+
+PipelineStats::PipelineStats(int periodFrames) :
+    xruns(0),
+    ringOverflows(0),
+    zeroFrames(0),
+    deadlineMisses(0),
+    recoveries(0),
+    packetDrops(0),
+    driftPpm(0.0f),
+    deadlineUs((uint32_t)((uint64_t)periodFrames * 1000000 / SAMPLE_RATE)) {
+}
+
+std::string PipelineStats::summaryLine() const {
+    char line[512];
+    int pos = 0;
+    
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        LatencyHistogram::Summary sum = latency[s].summarize();
+        pos += snprintf(line + pos, sizeof(line) - pos, "%s p50=%uus p99=%uus max=%uus, ",
+                        stageNames[s], sum.p50Us, sum.p99Us, sum.maxUs);
+    }
+    
+    snprintf(line + pos, sizeof(line) - pos,
+             "xruns=%u overflows=%u zero=%u missed=%u recovered=%u netdrop=%u drift=%+.1fppm",
+             xruns.load(), ringOverflows.load(),
+             zeroFrames.load(), deadlineMisses.load(), recoveries.load(), packetDrops.load(),
+             (double)driftPpm.load());
+    
+    return line;
+}
+
+std::string PipelineStats::report() const {
+    std::string out;
+    char line[256];
+    
+    snprintf(line, sizeof(line), "Pipeline statistics (deadline %u us per period)\n", deadlineUs);
+    out += line;
+    
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        LatencyHistogram::Summary sum = latency[s].summarize();
+        snprintf(line, sizeof(line), "  %-8s frames=%u p50=%u us p99=%u us max=%u us (%.1f%% of deadline)\n",
+                 stageNames[s], sum.count, sum.p50Us, sum.p99Us, sum.maxUs,
+                 deadlineUs ? 100.0 * sum.p99Us / deadlineUs : 0.0);
+        out += line;
+    }
+    
+    snprintf(line, sizeof(line),
+             "  xruns=%u ring_overflows=%u zero_frames=%u deadline_misses=%u recoveries=%u\n",
+             xruns.load(), ringOverflows.load(),
+             zeroFrames.load(), deadlineMisses.load(), recoveries.load());
+    out += line;
+    
+    snprintf(line, sizeof(line), "  clock drift correction %+.1f ppm, rtp_packet_drops=%u\n",
+             (double)driftPpm.load(), packetDrops.load());
+    out += line;
+    
+    return out;
+}
@@ -0,0 +1,97 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "beamformer_defs.h"
+
+// Pipeline stages with their own latency histogram
+enum PipelineStage {
+    STAGE_CAPTURE,
+    STAGE_PROCESS,
+    STAGE_OUTPUT,
+    STAGE_COUNT
+};
+
+// Lock-free latency histogram with LATENCY_BUCKET_US wide buckets.
+// record() is called by a single real-time thread; any thread may summarize.
+class LatencyHistogram {
+private:
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS];  // Last bucket collects overflow
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> maxUs;
+
+public:
+    struct Summary {
+        uint32_t count;
+        uint32_t p50Us;
+        uint32_t p99Us;
+        uint32_t maxUs;
+    };
+    
+    LatencyHistogram();
+    
+    // Single writer, so plain load/store avoids read-modify-write atomics
+    void record(uint32_t us) {
+        uint32_t bucket = us / LATENCY_BUCKET_US;
+        if (bucket >= LATENCY_BUCKETS) {
+            bucket = LATENCY_BUCKETS - 1;
+        }
+        buckets[bucket].store(buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed)) {
+            maxUs.store(us, std::memory_order_relaxed);
+        }
+    }
+    
+    Summary summarize() const;
+};
+
+// Timing and fault counters shared by capture, processing and output.
+// Stage latency is busy time per period: from the moment a stage has its
+// input until it has handed the result on. The output stage includes the
+// time the device blocks the write, so it is not counted against the deadline.
+struct PipelineStats {
+    LatencyHistogram latency[STAGE_COUNT];
+    
+    std::atomic<uint32_t> xruns;
+    std::atomic<uint32_t> ringOverflows;
+    std::atomic<uint32_t> zeroFrames;
+    std::atomic<uint32_t> deadlineMisses;
+    std::atomic<uint32_t> recoveries;  // Stages restarted after a fatal error
+    std::atomic<uint32_t> packetDrops; // RTP packets the socket did not take
+    std::atomic<float> driftPpm;       // Playback rate correction for clock drift
+    
+    uint32_t deadlineUs;  // One period at the configured frame size and rate
+    
+    explicit PipelineStats(int periodFrames = FRAME_SIZE);
+    
+    // Monotonic timestamp for stage timing
+    static uint64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    // Record the busy time of one period for a stage
+    void recordStage(PipelineStage stage, uint64_t startUs) {
+        uint32_t elapsed = (uint32_t)(nowUs() - startUs);
+        latency[stage].record(elapsed);
+        if (stage != STAGE_OUTPUT && elapsed > deadlineUs) {
+            deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    static void increment(std::atomic<uint32_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // One-line summary for periodic logging
+    std::string summaryLine() const;
+    
+    // Multi-line report for SIGUSR1
+    std::string report() const;
+};
+
+#endif // PIPELINE_STATS_H
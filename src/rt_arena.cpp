@@ -0,0 +1,21 @@
+#include "rt_arena.h"
+#include "rt_utils.h"
+#include <cstdlib>
+#include <cstring>
+
+RtArena::RtArena(size_t bytes) :
+    base(nullptr),
+    capacity(bytesFor<char>(bytes)),
+    used(0) {
+    
+    void* block = nullptr;
+    if (capacity > 0 && posix_memalign(&block, ALIGNMENT, capacity) == 0) {
+        base = static_cast<char*>(block);
+        memset(base, 0, capacity);
+        prefaultBuffer(base, capacity);
+    }
+}
+
+RtArena::~RtArena() {
+    free(base);
+}
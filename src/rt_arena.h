@@ -0,0 +1,50 @@
+#ifndef RT_ARENA_H
+#define RT_ARENA_H
+
+#include <cstddef>
+
+// Bump allocator for the buffers the real-time threads work in. One block
+// is allocated, zeroed and faulted in up front; allocate() only advances an
+// offset and nothing is freed until the arena is destroyed, so the audio
+// threads never reach the heap.
+class RtArena {
+private:
+    char* base;
+    size_t capacity;
+    size_t used;
+
+public:
+    static const size_t ALIGNMENT = 64;  // Cache line, also enough for NEON loads
+    
+    // Bytes 'count' objects of T take in an arena, alignment padding included
+    template <typename T>
+    static size_t bytesFor(size_t count) {
+        return (count * sizeof(T) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+    
+    explicit RtArena(size_t bytes);
+    ~RtArena();
+    
+    // Prevent copying
+    RtArena(const RtArena&) = delete;
+    RtArena& operator=(const RtArena&) = delete;
+    
+    bool valid() const { return base != nullptr; }
+    size_t bytesUsed() const { return used; }
+    size_t bytesTotal() const { return capacity; }
+    
+    // Zeroed storage for 'count' objects of T, nullptr when the arena is full
+    template <typename T>
+    T* allocate(size_t count) {
+        size_t bytes = bytesFor<T>(count);
+        if (!base || bytes > capacity - used) {
+            return nullptr;
+        }
+        
+        T* data = reinterpret_cast<T*>(base + used);
+        used += bytes;
+        return data;
+    }
+};
+
+#endif // RT_ARENA_H
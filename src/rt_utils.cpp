@@ -0,0 +1,194 @@
+#include "rt_utils.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+
+bool parseThreadRtConfig(const std::string& spec, ThreadRtConfig& rt) {
+    size_t at = spec.find('@');
+    std::string prio = spec.substr(0, at);
+    char* end = nullptr;
+    
+    ThreadRtConfig parsed;
+    if (!prio.empty()) {
+        parsed.priority = (int)strtol(prio.c_str(), &end, 10);
+        if (*end != '\0' || parsed.priority < 0 || parsed.priority > 99) {
+            return false;
+        }
+    }
+    
+    if (at != std::string::npos) {
+        std::string cpu = spec.substr(at + 1);
+        parsed.cpu = (int)strtol(cpu.c_str(), &end, 10);
+        if (cpu.empty() || *end != '\0' || parsed.cpu < 0) {
+            return false;
+        }
+    }
+    
+    rt = parsed;
+    return true;
+}
+
+bool applyThreadRtConfig(const ThreadRtConfig& rt, const char* threadName, Logger* logger) {
+    bool ok = true;
+    int err;
+    
+    if (rt.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(rt.cpu, &cpus);
+        
+        if ((err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0) {
+            logger->log(LOG_WARNING, std::string("Cannot pin ") + threadName + " thread to CPU " +
+                        std::to_string(rt.cpu) + ": " + strerror(err));
+            ok = false;
+        } else {
+            logger->log(LOG_INFO, std::string(threadName) + " thread pinned to CPU " + std::to_string(rt.cpu));
+        }
+    }
+    
+    if (rt.priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = rt.priority;
+        
+        if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0) {
+            if (err == EPERM) {
+                logger->log(LOG_WARNING, std::string("No permission for SCHED_FIFO on ") + threadName +
+                            " thread (needs CAP_SYS_NICE or RLIMIT_RTPRIO), using normal scheduling");
+            } else {
+                logger->log(LOG_WARNING, std::string("Cannot set SCHED_FIFO on ") + threadName + " thread: " + strerror(err));
+            }
+            ok = false;
+        } else {
+            logger->log(LOG_INFO, std::string(threadName) + " thread running SCHED_FIFO priority " +
+                        std::to_string(rt.priority));
+        }
+    }
+    
+    return ok;
+}
+
+bool lockProcessMemory(Logger* logger) {
+    // Keep freed memory in the heap instead of returning it to the kernel,
+    // and serve large allocations from the heap rather than fresh mappings
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        int err = errno;
+        logger->log(LOG_WARNING, std::string("Cannot lock memory: ") + strerror(err) +
+                    " (needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK), page faults remain possible");
+        return false;
+    }
+    
+    logger->log(LOG_INFO, "Process memory locked");
+    return true;
+}
+
+void prefaultStack(size_t bytes) {
+    // volatile so the compiler cannot drop the writes
+    volatile unsigned char* stack = (volatile unsigned char*)alloca(bytes);
+    long page = sysconf(_SC_PAGESIZE);
+    
+    for (size_t i = 0; i < bytes; i += page) {
+        stack[i] = 0;
+    }
+}
+
+void prefaultBuffer(void* data, size_t bytes) {
+    volatile unsigned char* p = (volatile unsigned char*)data;
+    long page = sysconf(_SC_PAGESIZE);
+    
+    // Read and write back so existing contents are preserved
+    for (size_t i = 0; i < bytes; i += page) {
+        p[i] = p[i];
+    }
+    if (bytes > 0) {
+        p[bytes - 1] = p[bytes - 1];
+    }
+}
+
+#ifdef RT_ALLOC_TRAP
+// The executable's definitions take precedence over libc's, forward to
+// glibc's internal entry points so there is no dlsym() recursion
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+static thread_local bool inRtSection = false;
+
+static void rtAllocTrap(const char* call) {
+    inRtSection = false;
+    static const char prefix[] = "RT allocation trap: ";
+    static const char suffix[] = " called from a real-time section\n";
+    ssize_t ignored = write(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+    ignored = write(STDERR_FILENO, call, strlen(call));
+    ignored = write(STDERR_FILENO, suffix, sizeof(suffix) - 1);
+    (void)ignored;
+    abort();
+}
+
+extern "C" void* malloc(size_t size) {
+    if (inRtSection) rtAllocTrap("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (inRtSection) rtAllocTrap("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (inRtSection) rtAllocTrap("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+    if (ptr && inRtSection) rtAllocTrap("free");
+    __libc_free(ptr);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) {
+    if (inRtSection) rtAllocTrap("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    if (inRtSection) rtAllocTrap("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (inRtSection) rtAllocTrap("posix_memalign");
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *out = ptr;
+    return 0;
+}
+
+void enterRtSection() {
+    inRtSection = true;
+}
+
+void leaveRtSection() {
+    inRtSection = false;
+}
+#else
+void enterRtSection() {}
+void leaveRtSection() {}
+#endif
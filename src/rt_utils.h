@@ -0,0 +1,42 @@
+#ifndef RT_UTILS_H
+#define RT_UTILS_H
+
+#include <cstddef>
+#include <string>
+#include "logger.h"
+
+// Scheduling and placement for one audio thread
+struct ThreadRtConfig {
+    int priority;  // SCHED_FIFO priority 1-99, 0 keeps the default policy
+    int cpu;       // CPU to pin the thread to, -1 for no affinity
+    
+    ThreadRtConfig(int prio = 0, int core = -1) : priority(prio), cpu(core) {}
+};
+
+// Parse "PRIO", "PRIO@CPU" or "@CPU". Returns false on malformed input.
+bool parseThreadRtConfig(const std::string& spec, ThreadRtConfig& rt);
+
+// Apply the policy to the calling thread. Missing privileges (no
+// CAP_SYS_NICE or RLIMIT_RTPRIO) are reported once and the thread keeps
+// running with its default policy. Returns true if everything was applied.
+bool applyThreadRtConfig(const ThreadRtConfig& rt, const char* threadName, Logger* logger);
+
+// Lock current and future pages in RAM and keep freed heap memory mapped,
+// so the audio threads never take a page fault. Falls back with a warning
+// when RLIMIT_MEMLOCK or the missing CAP_IPC_LOCK prevents it.
+bool lockProcessMemory(Logger* logger);
+
+// Touch 'bytes' of the calling thread's stack so it is resident before the
+// real-time loop starts
+void prefaultStack(size_t bytes);
+
+// Touch every page of a buffer
+void prefaultBuffer(void* data, size_t bytes);
+
+// Mark the calling thread's steady-state loop. Built with RT_ALLOC_TRAP
+// (BEAMFORMER_RT_ALLOC_TRAP in CMake) the malloc family is interposed and
+// aborts with a message when called inside a section; otherwise no-ops.
+void enterRtSection();
+void leaveRtSection();
+
+#endif // RT_UTILS_H
@@ -0,0 +1,257 @@
+#include "rtp_sink.h"
+#include "beamformer.h"
+#include "simd_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+static const size_t RTP_HEADER_BYTES = 12;
+static const size_t RTP_ANGLE_EXT_BYTES = 8;  // 0xBEDE profile, one word of elements
+
+static inline void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+RtpSink::RtpSink(const std::string& dest, CircularBuffer* inBuf, Logger* log, PipelineStats* st) :
+    destination(dest),
+    inputBuffer(inBuf),
+    logger(log),
+    stats(st),
+    angleSource(nullptr),
+    channels(1),
+    packetFrames(RTP_DEFAULT_PACKET_FRAMES),
+    socketFd(-1),
+    running(false),
+    sequence(0),
+    timestamp(0),
+    ssrc(0),
+    firstPacket(true),
+    sendFailing(false),
+    headerBytes(RTP_HEADER_BYTES),
+    packetBytes(0) {
+}
+
+RtpSink::~RtpSink() {
+    stop();
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+}
+
+bool RtpSink::init() {
+    size_t colon = destination.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == destination.size()) {
+        logger->log(LOG_ERR, "RTP destination must be HOST:PORT, got " + destination);
+        return false;
+    }
+    std::string host = destination.substr(0, colon);
+    std::string port = destination.substr(colon + 1);
+    if (host.size() > 2 && host[0] == '[' && host[host.size() - 1] == ']') {
+        host = host.substr(1, host.size() - 2);  // [v6addr]:port
+    }
+    
+    if (packetFrames <= 0) {
+        logger->log(LOG_ERR, "RTP packet size must be positive");
+        return false;
+    }
+    
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    
+    struct addrinfo* result = nullptr;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (err != 0) {
+        logger->log(LOG_ERR, "Cannot resolve RTP destination " + destination + ": " + gai_strerror(err));
+        return false;
+    }
+    
+    // Connected, so sendmmsg() needs no per-message address
+    for (struct addrinfo* ai = result; ai && socketFd < 0; ai = ai->ai_next) {
+        socketFd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (socketFd >= 0 && connect(socketFd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    
+    if (socketFd < 0) {
+        logger->log(LOG_ERR, "Cannot connect RTP socket to " + destination + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    // Random starting points as RFC 3550 asks
+    std::random_device seed;
+    ssrc = seed();
+    sequence = (uint16_t)seed();
+    timestamp = seed();
+    firstPacket = true;
+    
+    headerBytes = RTP_HEADER_BYTES + (angleSource ? RTP_ANGLE_EXT_BYTES : 0);
+    size_t payloadBytes = (size_t)packetFrames * channels * sizeof(int16_t);
+    packetBytes = headerBytes + payloadBytes;
+    if (payloadBytes > RTP_MAX_PAYLOAD) {
+        logger->log(LOG_WARNING, "RTP payload of " + std::to_string(payloadBytes) +
+                   " bytes exceeds one MTU and will fragment");
+    }
+    
+    packets.assign(packetBytes * RTP_MAX_BATCH, 0);
+    scratch.assign((size_t)packetFrames * channels, 0.0f);
+    iovecs.resize(RTP_MAX_BATCH);
+    messages.resize(RTP_MAX_BATCH);
+    for (int i = 0; i < RTP_MAX_BATCH; i++) {
+        iovecs[i].iov_base = packets.data() + i * packetBytes;
+        iovecs[i].iov_len = packetBytes;
+        memset(&messages[i], 0, sizeof(messages[i]));
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    logger->log(LOG_INFO, "RTP output to " + destination + ", " + std::to_string(packetFrames) +
+               " frames x " + std::to_string(channels) + " channels per packet, payload type " +
+               std::to_string(RTP_PAYLOAD_TYPE));
+    return true;
+}
+
+bool RtpSink::start() {
+    if (running) {
+        return true;
+    }
+    if (socketFd < 0) {
+        logger->log(LOG_ERR, "RTP output not initialized");
+        return false;
+    }
+    
+    running = true;
+    sinkThread = std::thread(&RtpSink::sinkLoop, this);
+    
+    logger->log(LOG_INFO, "RTP output started");
+    return true;
+}
+
+void RtpSink::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    if (sinkThread.joinable()) {
+        sinkThread.join();
+    }
+    
+    logger->log(LOG_INFO, "RTP output stopped");
+}
+
+// Header, optional angle extension, then the next packet of samples from
+// the ring as big-endian S16
+void RtpSink::buildPacket(uint8_t* packet, int angle) {
+    const size_t packetSamples = (size_t)packetFrames * channels;
+    
+    packet[0] = 0x80 | (angleSource ? 0x10 : 0x00);  // V=2, X when the angle is attached
+    packet[1] = (uint8_t)(RTP_PAYLOAD_TYPE | (firstPacket ? 0x80 : 0x00));  // Marker on the first packet
+    putU16(packet + 2, sequence);
+    putU32(packet + 4, timestamp);
+    putU32(packet + 8, ssrc);
+    
+    if (angleSource) {
+        // RFC 8285 one-byte form: ID, length - 1, then the angle in degrees
+        uint8_t* ext = packet + RTP_HEADER_BYTES;
+        putU16(ext, 0xBEDE);
+        putU16(ext + 2, 1);
+        ext[4] = (uint8_t)((RTP_ANGLE_EXT_ID << 4) | 1);
+        putU16(ext + 5, (uint16_t)(angle * DOA_ANGLE_STEP));
+        ext[7] = 0;
+    }
+    
+    int16_t* payload = reinterpret_cast<int16_t*>(packet + headerBytes);
+    const float* data = nullptr;
+    if (inputBuffer->acquireRead(&data, packetSamples) == packetSamples) {
+        simdFloatToS16(data, payload, packetSamples);
+        inputBuffer->releaseRead(packetSamples);
+    } else {
+        // Packet wraps around the end of the ring
+        inputBuffer->read(scratch.data(), packetSamples);
+        simdFloatToS16(scratch.data(), payload, packetSamples);
+    }
+    for (size_t i = 0; i < packetSamples; i++) {
+        payload[i] = (int16_t)htons((uint16_t)payload[i]);
+    }
+    
+    firstPacket = false;
+    sequence++;
+    timestamp += packetFrames;
+}
+
+void RtpSink::sendBatch(int count) {
+    int sent = 0;
+    while (sent < count) {
+        int result = sendmmsg(socketFd, messages.data() + sent, count - sent, MSG_DONTWAIT);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Full socket buffer or no listener yet: the audio is live, so
+            // drop the rest rather than fall behind
+            if (stats) stats->packetDrops.fetch_add(count - sent, std::memory_order_relaxed);
+            if (!sendFailing && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED) {
+                logger->logf(LOG_WARNING, "RTP send failed: %s", strerror(errno));
+                sendFailing = true;
+            }
+            return;
+        }
+        sent += result;
+    }
+    sendFailing = false;
+}
+
+void RtpSink::sinkLoop() {
+    const size_t packetSamples = (size_t)packetFrames * channels;
+    
+    logger->log(LOG_INFO, "RTP thread started, sending " + std::to_string(packetFrames) + " frames per packet");
+    
+    applyThreadRtConfig(rtConfig, "RTP", logger);
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    enterRtSection();
+    
+    while (running) {
+        if (!inputBuffer->waitForRead(packetSamples, 100)) {
+            if (inputBuffer->isClosed()) {
+                logger->logf(LOG_INFO, "Input buffer closed, exiting RTP loop");
+                break;
+            }
+            continue;
+        }
+        
+        uint64_t startUs = PipelineStats::nowUs();
+        
+        // Everything complete that is queued goes out in one system call;
+        // the packets of a batch share the angle read here
+        int count = (int)std::min(inputBuffer->availableRead() / packetSamples, (size_t)RTP_MAX_BATCH);
+        int angle = angleSource ? angleSource->getCurrentAngle() : 0;
+        for (int i = 0; i < count; i++) {
+            buildPacket(packets.data() + i * packetBytes, angle);
+        }
+        sendBatch(count);
+        
+        if (stats) stats->recordStage(STAGE_OUTPUT, startUs);
+    }
+    
+    leaveRtSection();
+    logger->log(LOG_INFO, "RTP thread stopped");
+}
@@ -0,0 +1,76 @@
+#ifndef RTP_SINK_H
+#define RTP_SINK_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include "beamformer_defs.h"
+#include "circular_buffer.h"
+#include "logger.h"
+#include "pipeline_stats.h"
+#include "rt_utils.h"
+
+class BeamFormer;
+
+// Network output in place of AlsaOutput: reads the beamformer output ring
+// and sends it as RTP over UDP, L16 with one channel per beam. Complete
+// packets are batched into one sendmmsg() call. With an angle source set,
+// each packet carries the steering angle in an RFC 8285 header extension.
+class RtpSink {
+private:
+    std::string destination;  // HOST:PORT
+    CircularBuffer* inputBuffer;
+    Logger* logger;
+    PipelineStats* stats;     // Optional, may be null
+    const BeamFormer* angleSource;
+    ThreadRtConfig rtConfig;
+    
+    int channels;
+    int packetFrames;
+    int socketFd;
+    
+    std::thread sinkThread;
+    std::atomic<bool> running;
+    
+    // RTP state, sinkThread only once started
+    uint16_t sequence;
+    uint32_t timestamp;
+    uint32_t ssrc;
+    bool firstPacket;
+    bool sendFailing;  // Log a send error once until a send succeeds again
+    
+    // RTP_MAX_BATCH packets, each header and extension then payload
+    size_t headerBytes;
+    size_t packetBytes;
+    std::vector<uint8_t> packets;
+    std::vector<float> scratch;  // One packet of float samples when the ring wraps
+    std::vector<struct iovec> iovecs;
+    std::vector<struct mmsghdr> messages;
+    
+    void sinkLoop();
+    void buildPacket(uint8_t* packet, int angle);
+    void sendBatch(int count);
+
+public:
+    RtpSink(const std::string& dest, CircularBuffer* inBuf, Logger* log, PipelineStats* st = nullptr);
+    ~RtpSink();
+    
+    // Prevent copying
+    RtpSink(const RtpSink&) = delete;
+    RtpSink& operator=(const RtpSink&) = delete;
+    
+    // Must be set before init()
+    void setChannels(int chans) { channels = chans; }
+    void setPacketFrames(int frames) { packetFrames = frames; }
+    void setAngleSource(const BeamFormer* bf) { angleSource = bf; }
+    void setRtConfig(const ThreadRtConfig& rt) { rtConfig = rt; }
+    int getPacketFrames() const { return packetFrames; }
+    
+    bool init();
+    bool start();
+    void stop();
+};
+
+#endif // RTP_SINK_H
@@ -0,0 +1,43 @@
+#include "sample_convert.h"
+#include "simd_utils.h"
+
+size_t sampleFormatBytes(SampleFormat format) {
+    return format == SAMPLE_FORMAT_S16 ? sizeof(int16_t) : sizeof(int32_t);
+}
+
+const char* sampleFormatName(SampleFormat format) {
+    switch (format) {
+        case SAMPLE_FORMAT_S16: return "S16_LE";
+        case SAMPLE_FORMAT_S24: return "S24_LE";
+        case SAMPLE_FORMAT_S32: return "S32_LE";
+        default: return "auto";
+    }
+}
+
+void convertToFloat(SampleFormat format, const void* in, float* out, size_t count) {
+    switch (format) {
+        case SAMPLE_FORMAT_S32:
+            simdS32ToFloat((const int32_t*)in, out, count, 0);
+            break;
+        case SAMPLE_FORMAT_S24:
+            simdS32ToFloat((const int32_t*)in, out, count, 8);
+            break;
+        default:
+            simdS16ToFloat((const int16_t*)in, out, count);
+            break;
+    }
+}
+
+void convertFromFloat(SampleFormat format, const float* in, void* out, size_t count) {
+    switch (format) {
+        case SAMPLE_FORMAT_S32:
+            simdFloatToS32(in, (int32_t*)out, count, 0);
+            break;
+        case SAMPLE_FORMAT_S24:
+            simdFloatToS32(in, (int32_t*)out, count, 8);
+            break;
+        default:
+            simdFloatToS16(in, (int16_t*)out, count);
+            break;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef SAMPLE_CONVERT_H
+#define SAMPLE_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "beamformer_defs.h"
+
+// Conversion between device sample formats and the internal float format,
+// done once at the capture and playback edges. 'count' is in samples, not
+// frames. Float to integer rounds to nearest and saturates.
+
+size_t sampleFormatBytes(SampleFormat format);
+const char* sampleFormatName(SampleFormat format);
+
+void convertToFloat(SampleFormat format, const void* in, float* out, size_t count);
+void convertFromFloat(SampleFormat format, const float* in, void* out, size_t count);
+
+#endif // SAMPLE_CONVERT_H
@@ -0,0 +1,242 @@
+#include "simd_utils.h"
+#include <cmath>
+#include <algorithm>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+static const float S16_SCALE = 32768.0f;
+static const float S32_SCALE = 2147483648.0f;
+
+bool simdAvailable() {
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    return true;  // Advanced SIMD is mandatory on AArch64
+#elif defined(__ARM_NEON) && defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#elif defined(__ARM_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static bool simdOn = simdAvailable();
+
+bool simdEnabled() {
+    return simdOn;
+}
+
+void setSimdEnabled(bool enable) {
+    simdOn = enable && simdAvailable();
+}
+
+#ifdef __ARM_NEON
+// Round to nearest, ARMv7 has no rounding conversion so bias by +/-0.5
+static inline int32x4_t roundToInt(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    float32x4_t bias = vbslq_f32(vcltq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(v, bias));
+#endif
+}
+
+static inline float horizontalMax(float32x4_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_f32(v);
+#else
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+#endif
+}
+
+static inline float horizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+    return vaddvq_f32(v);
+#else
+    float32x2_t s = vpadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+#endif
+
+float simdDeinterleave(const float* in, float* const* out, int channels, size_t frames) {
+    float energy = 0.0f;
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        // 4 frames per iteration
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        if (channels == 2) {
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v = vld2q_f32(in + i * 2);
+                vst1q_f32(out[0] + i, v.val[0]);
+                vst1q_f32(out[1] + i, v.val[1]);
+                sum = vmlaq_f32(vmlaq_f32(sum, v.val[0], v.val[0]), v.val[1], v.val[1]);
+            }
+        } else if (channels == 4) {
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x4_t v = vld4q_f32(in + i * 4);
+                for (int c = 0; c < 4; c++) {
+                    vst1q_f32(out[c] + i, v.val[c]);
+                    sum = vmlaq_f32(sum, v.val[c], v.val[c]);
+                }
+            }
+        } else if (channels == 8) {
+            // Each vld4q spans two frames, so val[c] alternates channels c and
+            // c + 4; unzipping the two loads separates them
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x4_t lo = vld4q_f32(in + i * 8);
+                float32x4x4_t hi = vld4q_f32(in + i * 8 + 16);
+                for (int c = 0; c < 4; c++) {
+                    float32x4x2_t v = vuzpq_f32(lo.val[c], hi.val[c]);
+                    vst1q_f32(out[c] + i, v.val[0]);
+                    vst1q_f32(out[c + 4] + i, v.val[1]);
+                    sum = vmlaq_f32(vmlaq_f32(sum, v.val[0], v.val[0]), v.val[1], v.val[1]);
+                }
+            }
+        }
+        energy = horizontalSum(sum);
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            float sample = in[i * channels + c];
+            out[c][i] = sample;
+            energy += sample * sample;
+        }
+    }
+    return energy;
+}
+
+void simdInterleave(const float* const* in, float* out, int channels, size_t frames) {
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        if (channels == 2) {
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v;
+                v.val[0] = vld1q_f32(in[0] + i);
+                v.val[1] = vld1q_f32(in[1] + i);
+                vst2q_f32(out + i * 2, v);
+            }
+        } else if (channels == 4) {
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x4_t v;
+                for (int c = 0; c < 4; c++) {
+                    v.val[c] = vld1q_f32(in[c] + i);
+                }
+                vst4q_f32(out + i * 4, v);
+            }
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            out[i * channels + c] = in[c][i];
+        }
+    }
+}
+
+void simdS16ToFloat(const int16_t* in, float* out, size_t count) {
+    const float scale = 1.0f / S16_SCALE;
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t v = vld1q_s16(in + i);
+            vst1q_f32(out + i,     vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+            vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = in[i] * scale;
+    }
+}
+
+void simdFloatToS16(const float* in, int16_t* out, size_t count) {
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        for (; i + 8 <= count; i += 8) {
+            int32x4_t lo = roundToInt(vmulq_n_f32(vld1q_f32(in + i), S16_SCALE));
+            int32x4_t hi = roundToInt(vmulq_n_f32(vld1q_f32(in + i + 4), S16_SCALE));
+            vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        long sample = lrintf(in[i] * S16_SCALE);
+        out[i] = (int16_t)std::max(-32768L, std::min(32767L, sample));
+    }
+}
+
+void simdS32ToFloat(const int32_t* in, float* out, size_t count, int shift) {
+    const float scale = 1.0f / S32_SCALE;
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        int32x4_t shiftBy = vdupq_n_s32(shift);
+        for (; i + 4 <= count; i += 4) {
+            int32x4_t v = vshlq_s32(vld1q_s32(in + i), shiftBy);
+            vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(v), scale));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (int32_t)((uint32_t)in[i] << shift) * scale;
+    }
+}
+
+// The NEON conversion saturates at the int32 range by itself
+void simdFloatToS32(const float* in, int32_t* out, size_t count, int shift) {
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        int32x4_t shiftBy = vdupq_n_s32(-shift);
+        for (; i + 4 <= count; i += 4) {
+            int32x4_t v = roundToInt(vmulq_n_f32(vld1q_f32(in + i), S32_SCALE));
+            vst1q_s32(out + i, vshlq_s32(v, shiftBy));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        // 2^31 - 128 is the largest float that still fits
+        float sample = std::max(-S32_SCALE, std::min(S32_SCALE - 128.0f, in[i] * S32_SCALE));
+        out[i] = (int32_t)lrintf(sample) >> shift;
+    }
+}
+
+SignalLevel simdScanLevel(const float* data, size_t count) {
+    float peak = 0.0f;
+    float energy = 0.0f;
+    size_t i = 0;
+#ifdef __ARM_NEON
+    if (simdOn) {
+        float32x4_t maxAbs = vdupq_n_f32(0.0f);
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t v = vld1q_f32(data + i);
+            maxAbs = vmaxq_f32(maxAbs, vabsq_f32(v));
+            sum = vmlaq_f32(sum, v, v);
+        }
+        peak = horizontalMax(maxAbs);
+        energy = horizontalSum(sum);
+    }
+#endif
+    for (; i < count; i++) {
+        peak = std::max(peak, fabsf(data[i]));
+        energy += data[i] * data[i];
+    }
+    
+    SignalLevel level;
+    level.peak = peak;
+    level.rms = count > 0 ? sqrtf(energy / count) : 0.0f;
+    return level;
+}
@@ -0,0 +1,42 @@
+#ifndef SIMD_UTILS_H
+#define SIMD_UTILS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vector helpers for the sample-shuffling loops around the DSP. Each has a
+// NEON implementation, used when the build targets NEON and the CPU reports
+// it at run time, and a scalar fallback. 'count' is in samples, 'frames' in
+// interleaved frames.
+
+// NEON compiled in and supported by this CPU
+bool simdAvailable();
+
+// Whether the NEON paths are taken, e.g. off to compare against scalar.
+// Change only before the audio threads start.
+bool simdEnabled();
+void setSimdEnabled(bool enable);
+
+// Interleaved frames to one plane per channel and back; 2 and 4 channels
+// use vld2q/vld4q (vst2q/vst4q), 8 channels pairs of vld4q. De-interleaving
+// returns the sum of squares of the samples moved, for level checks that
+// should not read the frame a second time.
+float simdDeinterleave(const float* in, float* const* out, int channels, size_t frames);
+void simdInterleave(const float* const* in, float* out, int channels, size_t frames);
+
+// Integer samples to float with full scale at +/-1.0 and back, rounding to
+// nearest and saturating. The 32-bit forms shift left by 'shift' before
+// converting (right after), so S24 in the low bytes shares the S32 scale.
+void simdS16ToFloat(const int16_t* in, float* out, size_t count);
+void simdFloatToS16(const float* in, int16_t* out, size_t count);
+void simdS32ToFloat(const int32_t* in, float* out, size_t count, int shift);
+void simdFloatToS32(const float* in, int32_t* out, size_t count, int shift);
+
+// Peak magnitude and RMS of a block
+struct SignalLevel {
+    float peak;
+    float rms;
+};
+SignalLevel simdScanLevel(const float* data, size_t count);
+
+#endif // SIMD_UTILS_H
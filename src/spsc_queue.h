@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-capacity lock-free single-producer/single-consumer queue of small
+// trivially copyable records. push() never blocks or allocates: when the
+// queue is full the record is rejected and the caller decides what to do.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+    
+    T items[Capacity];
+    
+    char padBefore[CACHE_LINE_SIZE];
+    std::atomic<size_t> head;   // Written by producer only
+    char padHead[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;   // Written by consumer only
+    char padTail[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+    
+    // Prevent copying
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+    
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        
+        items[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return false;
+        }
+        
+        item = items[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SPSC_QUEUE_H
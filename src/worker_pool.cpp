@@ -0,0 +1,114 @@
+#include "worker_pool.h"
+#include "beamformer.h"
+#include <unistd.h>
+
+int WorkerPool::onlineCpus() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+WorkerPool::WorkerPool(int threads, const ThreadRtConfig& rt, Logger* log) :
+    rtConfig(rt),
+    logger(log),
+    running(false),
+    nextWorker(0) {
+    
+    const int cpus = onlineCpus();
+    if (threads <= 0) {
+        threads = cpus;
+    }
+    
+    const int firstCpu = rt.cpu >= 0 ? rt.cpu : 0;
+    for (int w = 0; w < threads; w++) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->cpu = (firstCpu + w) % cpus;
+        workers.push_back(std::move(worker));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+bool WorkerPool::add(BeamFormer* beamformer) {
+    Worker* worker = workers[nextWorker].get();
+    if (running || worker->jobs.size() >= MAX_ARRAYS) {
+        return false;
+    }
+    
+    worker->jobs.push_back(beamformer);
+    nextWorker = (nextWorker + 1) % workers.size();
+    return true;
+}
+
+bool WorkerPool::start() {
+    if (running) {
+        return true;
+    }
+    
+    running = true;
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w]->thread = std::thread(&WorkerPool::workerLoop, this, workers[w].get());
+    }
+    
+    logger->log(LOG_INFO, "Worker pool started with " + std::to_string(workers.size()) + " threads");
+    return true;
+}
+
+void WorkerPool::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    for (size_t w = 0; w < workers.size(); w++) {
+        if (workers[w]->thread.joinable()) {
+            workers[w]->thread.join();
+        }
+    }
+    
+    logger->log(LOG_INFO, "Worker pool stopped");
+}
+
+void WorkerPool::workerLoop(Worker* worker) {
+    logger->log(LOG_INFO, "Worker thread started on CPU " + std::to_string(worker->cpu) + " for " +
+               std::to_string(worker->jobs.size()) + " arrays");
+    
+    ThreadRtConfig rt(rtConfig.priority, worker->cpu);
+    applyThreadRtConfig(rt, "Worker", logger);
+    prefaultStack(RT_STACK_PREFAULT_BYTES);
+    logger->prepareThread();
+    
+    // Beamformers still running, with the ring and frame each waits for
+    BeamFormer* jobs[MAX_ARRAYS];
+    CircularBuffer* rings[MAX_ARRAYS];
+    size_t frames[MAX_ARRAYS];
+    int count = 0;
+    for (size_t j = 0; j < worker->jobs.size() && j < MAX_ARRAYS; j++, count++) {
+        jobs[count] = worker->jobs[j];
+        rings[count] = jobs[count]->getInputBuffer();
+        frames[count] = jobs[count]->getInputFrameSamples();
+    }
+    
+    enterRtSection();
+    
+    while (running && count > 0) {
+        // One frame of each per pass, so a busy array cannot starve the others
+        for (int j = 0; j < count;) {
+            if (jobs[j]->processPending()) {
+                j++;
+                continue;
+            }
+            count--;
+            jobs[j] = jobs[count];
+            rings[j] = rings[count];
+            frames[j] = frames[count];
+        }
+        
+        CircularBuffer::waitForAnyRead(rings, frames, count, POOL_WAIT_MS);
+    }
+    
+    leaveRtSection();
+    logger->log(LOG_INFO, "Worker thread stopped");
+}
@@ -0,0 +1,60 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "beamformer_defs.h"
+#include "rt_utils.h"
+#include "logger.h"
+
+class BeamFormer;
+
+// Pinned threads running the processing of several beamformers, in place
+// of a processing thread per instance. Each beamformer stays on the worker
+// it was given, so its frames are processed in order on one core and its
+// statistics keep a single writer. A worker sleeps on the input rings of
+// all its beamformers at once and processes a frame of each that has one.
+class WorkerPool {
+private:
+    struct Worker {
+        std::thread thread;
+        std::vector<BeamFormer*> jobs;
+        int cpu;
+    };
+    
+    std::vector<std::unique_ptr<Worker>> workers;
+    ThreadRtConfig rtConfig;
+    Logger* logger;  // Shared with the beamformers, their records go to its queues
+    std::atomic<bool> running;
+    size_t nextWorker;
+    
+    void workerLoop(Worker* worker);
+
+public:
+    // 'threads' workers, 0 for one per online CPU. Each gets rt.priority
+    // and worker w is pinned to CPU (rt.cpu + w) modulo the CPU count,
+    // starting from CPU 0 when rt.cpu is -1.
+    WorkerPool(int threads, const ThreadRtConfig& rt, Logger* log);
+    ~WorkerPool();
+    
+    // Prevent copying
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    // Assign an initialised beamformer with its scratch buffers set to the
+    // next worker in turn, at most MAX_ARRAYS per worker; before start()
+    bool add(BeamFormer* beamformer);
+    
+    bool start();
+    
+    // Join the workers; close the input rings first so none waits on them
+    void stop();
+    
+    int getWorkerCount() const { return (int)workers.size(); }
+    
+    static int onlineCpus();
+};
+
+#endif // WORKER_POOL_H